@@ -2,502 +2,1013 @@
 // Handles instruction decoding, execution, and state serialization for CHIP-8, SCHIP, XO-CHIP
 
 #include "chip8_cpu.h"
-#include <stdexcept>
+#include "chip8_savestate.h"
 #include <iostream>
 #include <random>
 #include <array>
-#include <chrono>
 #include <fstream>
 #include <string>
+#include <algorithm>
+#include <cstring>
 
 namespace {
-    // Size of XO-CHIP audio pattern buffer (16 patterns, 16 bytes each)
-    constexpr size_t XOCHIP_AUDIO_BUFFER_SIZE = 16 * 16;
-}
+    // Instructions per 60 Hz frame (~700 Hz, ~1000 Hz and ~2000 Hz)
+    int defaultCyclesPerFrame(Chip8CPU::Variant variant) {
+        switch (variant) {
+        case Chip8CPU::Variant::SCHIP: return 17;
+        case Chip8CPU::Variant::XOCHIP: return 33;
+        default: return 12;
+        }
+    }
 
-class Chip8CPU_AudioBuffer {
-public:
-    std::array<uint8_t, XOCHIP_AUDIO_BUFFER_SIZE> buffer{};
-};
+    // Prefix of every snapshot blob
+    struct SnapshotHeader {
+        uint32_t magic;
+        uint32_t memorySize;
+    };
+    constexpr uint32_t SNAPSHOT_MAGIC = 0x53533843; // "C8SS"
+
+    // Guest memory size for each variant
+    size_t memorySizeFor(Chip8CPU::Variant variant) {
+        switch (variant) {
+        case Chip8CPU::Variant::SCHIP: return Chip8Memory::SCHIP_MEMORY_SIZE;
+        case Chip8CPU::Variant::XOCHIP: return Chip8Memory::XOCHIP_MEMORY_SIZE;
+        default: return Chip8Memory::CHIP8_MEMORY_SIZE;
+        }
+    }
+}
 
 Chip8CPU::Chip8CPU(Variant variant)
-    : mode(variant),
-      mem(variant == Variant::XOCHIP ? Chip8Memory::XOCHIP_MEMORY_SIZE :
-          (variant == Variant::SCHIP ? Chip8Memory::SCHIP_MEMORY_SIZE : Chip8Memory::CHIP8_MEMORY_SIZE))
-{}
-
-Chip8Memory& Chip8CPU::memory() { return mem; }
-Chip8Registers& Chip8CPU::registers() { return regs; }
-Chip8Timers& Chip8CPU::timers() { return tmr; }
-Chip8Input& Chip8CPU::input() { return inp; }
-Chip8Display& Chip8CPU::display() { return disp; }
+    : decodeCache(memorySizeFor(variant)),
+      breakpoints(memorySizeFor(variant), false)
+{
+    state.mode = variant;
+    state.mem.reset(memorySizeFor(variant));
+    state.cyclesPerFrame = defaultCyclesPerFrame(variant);
+    selectDecoder();
+    seedRandomNondeterministic();
+}
+
+void Chip8CPU::reset(Variant variant, const Quirks& q) {
+    state.mode = variant;
+    state.quirks = q;
+    state.mem.reset(memorySizeFor(variant));
+    state.regs = Chip8Registers();
+    state.tmr = Chip8Timers();
+    state.inp = Chip8Input();
+    uint64_t displayGeneration = state.disp.generation();
+    state.disp = Chip8Display();
+    state.disp.markReplaced(displayGeneration);
+    snd.stop();
+    snd.setPhase(0);
+    state.audioBuffer.fill(0);
+    decodeCache.assign(state.mem.size(), Instruction{});
+    breakpoints.assign(state.mem.size(), false);
+    breakpointCount = 0;
+    state.cyclesPerFrame = defaultCyclesPerFrame(variant);
+    state.frameCycles = 0;
+    state.cycleCount = 0;
+    state.frameCount = 0;
+    state.skippedCycles = 0;
+    state.lastDrawFrame = UINT64_MAX;
+    state.keyWaitRelease = false;
+    state.keyWaitKey = -1;
+    state.fault = Fault::None;
+    selectDecoder();
+    seedRandomNondeterministic();
+}
+
+Chip8CPU::Quirks Chip8CPU::defaultQuirks(Variant variant) {
+    if (variant == Variant::SCHIP) return {false, false, true};
+    return {true, true, false};
+}
+
+Chip8Memory& Chip8CPU::memory() { return state.mem; }
+Chip8Registers& Chip8CPU::registers() { return state.regs; }
+Chip8Timers& Chip8CPU::timers() { return state.tmr; }
+Chip8Input& Chip8CPU::input() { return state.inp; }
+Chip8Display& Chip8CPU::display() { return state.disp; }
 Chip8Sound& Chip8CPU::sound() { return snd; }
-Chip8CPU::Variant Chip8CPU::getVariant() const { return mode; }
+Chip8CPU::Variant Chip8CPU::getVariant() const { return state.mode; }
+
+void Chip8CPU::setQuirks(const Quirks& q) {
+    state.quirks = q;
+    invalidateDecodeCache();
+}
+Chip8CPU::Quirks Chip8CPU::getQuirks() const { return state.quirks; }
 
-void Chip8CPU::setQuirks(const Quirks& q) { quirks = q; }
-Chip8CPU::Quirks Chip8CPU::getQuirks() const { return quirks; }
+void Chip8CPU::seedRandom(uint64_t seed) {
+    state.rngSeed = seed;
+    // splitmix64 spreads small seeds over the whole state
+    uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    state.rngState = z ? z : 0x9E3779B97F4A7C15ULL;
+}
+
+void Chip8CPU::seedRandomNondeterministic() {
+    std::random_device rd;
+    seedRandom((static_cast<uint64_t>(rd()) << 32) | rd());
+}
+
+uint64_t Chip8CPU::getRandomSeed() const { return state.rngSeed; }
+
+uint8_t Chip8CPU::nextRandom() {
+    state.rngState ^= state.rngState >> 12;
+    state.rngState ^= state.rngState << 25;
+    state.rngState ^= state.rngState >> 27;
+    return static_cast<uint8_t>((state.rngState * 0x2545F4914F6CDD1DULL) >> 56);
+}
+
+void Chip8CPU::invalidateDecodeCache() {
+    std::fill(decodeCache.begin(), decodeCache.end(), Instruction{});
+}
+
+void Chip8CPU::setDecodeCacheEnabled(bool enabled) {
+    if (enabled && !decodeCacheEnabled) invalidateDecodeCache();
+    decodeCacheEnabled = enabled;
+}
+
+bool Chip8CPU::getDecodeCacheEnabled() const { return decodeCacheEnabled; }
 
 uint16_t Chip8CPU::fetchOpcode() {
-    uint16_t pc = regs.PC();
-    uint8_t high = mem.read(pc);
-    uint8_t low = mem.read(pc + 1);
+    uint16_t pc = state.regs.PC();
+    uint8_t high = state.mem.read(pc);
+    uint8_t low = state.mem.read(pc + 1);
     return (high << 8) | low;
 }
 
+const Chip8CPU::Instruction& Chip8CPU::fetchInstruction() {
+    uint16_t pc = state.regs.PC();
+    if (pc + 1u >= decodeCache.size()) {
+        uncached = Instruction{};
+        uncached.handler = &Chip8CPU::opBadPC;
+        uncached.endsBlock = true;
+        return uncached;
+    }
+    if (!decodeCacheEnabled) {
+        uncached = decode(fetchOpcode());
+        return uncached;
+    }
+    Instruction& cached = decodeCache[pc];
+    if (!cached.handler) cached = decode(fetchOpcode());
+    return cached;
+}
+
+void Chip8CPU::writeMemory(uint16_t address, uint8_t value) {
+    address &= state.mem.addressMask();
+    state.mem.write(address, value);
+    // An instruction starting at address or address - 1 covers this byte
+    decodeCache[address].handler = nullptr;
+    if (address > 0) decodeCache[address - 1].handler = nullptr;
+}
+
+bool Chip8CPU::checkRange(uint16_t address, int span) {
+    if (address + span <= static_cast<int>(state.mem.size())) return true;
+    state.fault = Fault::AddressOutOfRange;
+    return false;
+}
+
+void Chip8CPU::reportFault(uint16_t pc) {
+    state.regs.PC() = pc;
+    if (faultCallback) faultCallback(state.fault, pc);
+}
+
+Chip8CPU::Fault Chip8CPU::getFault() const { return state.fault; }
+void Chip8CPU::clearFault() { state.fault = Fault::None; }
+void Chip8CPU::setFaultCallback(FaultCallback callback) { faultCallback = std::move(callback); }
+
 void Chip8CPU::step() {
-    uint16_t opcode = fetchOpcode();
-    regs.PC() += 2;
-    executeOpcode(opcode);
-    if (tmr.getSound() > 0) {
-        snd.start();
-    } else {
-        snd.stop();
+    if (state.fault != Fault::None) return;
+    uint16_t pc = state.regs.PC();
+    const Instruction& instr = fetchInstruction();
+    state.regs.PC() += 2;
+    (this->*instr.handler)(instr);
+    if (state.fault != Fault::None) {
+        reportFault(pc);
+        return;
     }
+    accountCycles(1);
+    updateSound();
 }
 
-void Chip8CPU::executeOpcode(uint16_t opcode) {
-    uint8_t n1 = (opcode & 0xF000) >> 12;
-    uint8_t n2 = (opcode & 0x0F00) >> 8;
-    uint8_t n3 = (opcode & 0x00F0) >> 4;
-    uint8_t n4 = (opcode & 0x000F);
-    uint16_t nnn = opcode & 0x0FFF;
-    uint8_t nn = opcode & 0x00FF;
-    uint8_t x = n2;
-    uint8_t y = n3;
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(0, 255);
-
-    if (mode == Variant::SCHIP || mode == Variant::XOCHIP) {
-        if ((opcode & 0xFFF0) == 0x00C0) {
-            uint8_t n = opcode & 0x000F;
-            int lines = 0;
-            if (mode == Variant::XOCHIP) {
-                lines = (disp.getMode() == Chip8Display::Mode::LowRes) ? n : n * 2;
-            } else {
-                lines = n;
-            }
-            disp.scrollDown(lines);
-            return;
-        }
-        if (opcode == 0x00FB) {
-            disp.scrollRight();
-            return;
-        }
-        if (opcode == 0x00FC) {
-            disp.scrollLeft();
-            return;
-        }
-        if ((opcode & 0xFFF0) == 0x00FA) {
-            uint8_t n = opcode & 0x000F;
-            int lines = 0;
-            if (mode == Variant::XOCHIP) {
-                lines = (disp.getMode() == Chip8Display::Mode::LowRes) ? n : n * 2;
-            } else {
-                lines = n;
-            }
-            disp.scrollUp(lines);
-            return;
-        }
-        if (opcode == 0x00FE) {
-            disp.setMode(Chip8Display::Mode::LowRes);
-            return;
+int Chip8CPU::runBlock(int maxInstructions) {
+    int budget = std::min(maxInstructions, state.cyclesPerFrame - state.frameCycles);
+    int executed = 0;
+    while (executed < budget && state.fault == Fault::None) {
+        uint16_t pc = state.regs.PC();
+        // Self-modifying writes only clear the handler, so endsBlock stays readable
+        const Instruction& instr = fetchInstruction();
+        state.regs.PC() += 2;
+        (this->*instr.handler)(instr);
+        if (state.fault != Fault::None) {
+            reportFault(pc);
+            break;
         }
-        if (opcode == 0x00FF) {
-            disp.setMode(Chip8Display::Mode::HighRes);
-            return;
+        ++executed;
+        if (instr.endsBlock) break;
+    }
+    accountCycles(executed);
+    updateSound();
+    return executed;
+}
+
+Chip8CPU::RunResult Chip8CPU::runCycles(int maxCycles) {
+    if (state.fault != Fault::None) return RunResult::Fault;
+    RunResult result = RunResult::CycleBudget;
+    int budget = std::min(maxCycles, state.cyclesPerFrame - state.frameCycles);
+    int executed = 0;
+    while (executed < budget) {
+        uint16_t pc = state.regs.PC();
+        if (breakpointCount > 0 && executed > 0 && pc < breakpoints.size() && breakpoints[pc]) {
+            result = RunResult::Breakpoint;
+            break;
         }
-        if (opcode == 0x00FD) {
-            return;
+        const Instruction& instr = fetchInstruction();
+        state.regs.PC() += 2;
+        (this->*instr.handler)(instr);
+        if (state.fault != Fault::None) {
+            reportFault(pc);
+            result = RunResult::Fault;
+            break;
         }
-        if ((opcode & 0xF00F) == 0xD000 && n4 == 0) {
-            uint8_t vx = regs.V(x);
-            uint8_t vy = regs.V(y);
-            bool collision = false;
-            for (int row = 0; row < 16; ++row) {
-                uint16_t spriteRow = (mem.read(regs.I() + row * 2) << 8) | mem.read(regs.I() + row * 2 + 1);
-                for (int col = 0; col < 16; ++col) {
-                    if ((spriteRow & (0x8000 >> col)) != 0) {
-                        int px = (vx + col) % disp.width();
-                        int py = (vy + row) % disp.height();
-                        if (disp.getPixel(px, py)) collision = true;
-                        disp.setPixel(px, py, disp.getPixel(px, py) ^ true);
-                    }
-                }
+        ++executed;
+        // Waits and idle loops jump back onto themselves. Keys and timers only change
+        // between batches, so the rest of this batch would repeat the same instructions.
+        // Only whole iterations are skipped; the remainder runs normally, so PC and the
+        // loop phase at the end of the batch are the ones plain stepping reaches
+        if (instr.endsBlock && state.regs.PC() <= pc) {
+            RunResult wait = RunResult::Idle;
+            int length = 1;
+            if ((instr.opcode & 0xF0FF) == 0xF00A) wait = RunResult::WaitingForKey;
+            else if ((instr.opcode & 0xF000) == 0xD000) wait = RunResult::DisplayWait;
+            else length = idleLoopLength(pc, instr);
+            if (length > 0 && !hasBreakpoint(state.regs.PC(), length)) {
+                int skipped = (budget - executed) / length * length;
+                // Each skipped poll iteration ends with the delay timer loaded into VX
+                if (length > 1 && skipped > 0) state.regs.V(instr.opcode >> 8 & 0xF) = state.tmr.getDelay();
+                state.skippedCycles += skipped;
+                executed += skipped;
+                result = wait;
             }
-            regs.V(0xF) = collision ? 1 : 0;
-            return;
         }
     }
+    bool frameEnded = state.frameCycles + executed >= state.cyclesPerFrame;
+    accountCycles(executed);
+    if (result == RunResult::CycleBudget && frameEnded) {
+        result = RunResult::FrameBoundary;
+    }
+    updateSound();
+    return result;
+}
+
+Chip8CPU::RunResult Chip8CPU::runFrame() {
+    return runCycles(state.cyclesPerFrame);
+}
+
+int Chip8CPU::idleLoopLength(uint16_t pc, const Instruction& instr) const {
+    if ((instr.opcode & 0xF000) != 0x1000) return 0;
+    // 1NNN jumping onto itself
+    if (instr.nnn == pc) return 1;
+    // Delay timer poll: FX07 / 3XNN or 4XNN / 1NNN back to the FX07
+    if (instr.nnn + 4 != pc) return 0;
+    uint16_t load = (state.mem.read(pc - 4) << 8) | state.mem.read(pc - 3);
+    uint16_t test = (state.mem.read(pc - 2) << 8) | state.mem.read(pc - 1);
+    if ((load & 0xF0FF) != 0xF007) return 0;
+    if ((test & 0xF000) != 0x3000 && (test & 0xF000) != 0x4000) return 0;
+    if ((load & 0x0F00) != (test & 0x0F00)) return 0;
+    // With the current delay value loaded the test must not skip the jump
+    bool equal = state.tmr.getDelay() == (test & 0xFF);
+    return (equal == ((test & 0xF000) == 0x4000)) ? 3 : 0;
+}
+
+bool Chip8CPU::hasBreakpoint(uint16_t address, int instructions) const {
+    if (breakpointCount == 0) return false;
+    for (int i = 0; i < instructions; ++i) {
+        size_t at = address + 2 * i;
+        if (at < breakpoints.size() && breakpoints[at]) return true;
+    }
+    return false;
+}
+
+void Chip8CPU::endFrame() {
+    state.tmr.tick();
+    state.frameCycles = 0;
+    ++state.frameCount;
+}
+
+void Chip8CPU::accountCycles(int cycles) {
+    state.cycleCount += cycles;
+    state.frameCycles += cycles;
+    if (state.frameCycles >= state.cyclesPerFrame) endFrame();
+}
+
+void Chip8CPU::setCyclesPerFrame(int cycles) { state.cyclesPerFrame = std::max(cycles, 1); }
+int Chip8CPU::getCyclesPerFrame() const { return state.cyclesPerFrame; }
+uint64_t Chip8CPU::getCycleCount() const { return state.cycleCount; }
+uint64_t Chip8CPU::getFrameCount() const { return state.frameCount; }
+uint64_t Chip8CPU::getSkippedCycleCount() const { return state.skippedCycles; }
+
+void Chip8CPU::addBreakpoint(uint16_t address) {
+    if (address < breakpoints.size() && !breakpoints[address]) {
+        breakpoints[address] = true;
+        ++breakpointCount;
+    }
+}
+
+void Chip8CPU::removeBreakpoint(uint16_t address) {
+    if (address < breakpoints.size() && breakpoints[address]) {
+        breakpoints[address] = false;
+        --breakpointCount;
+    }
+}
+
+void Chip8CPU::clearBreakpoints() {
+    std::fill(breakpoints.begin(), breakpoints.end(), false);
+    breakpointCount = 0;
+}
 
-    switch (n1) {
+void Chip8CPU::updateSound() {
+    if (state.tmr.getSound() > 0) {
+        snd.start();
+    } else {
+        snd.stop();
+    }
+}
+
+Chip8CPU::Instruction Chip8CPU::decode(uint16_t opcode) const {
+    return (this->*decoder)(opcode);
+}
+
+void Chip8CPU::selectDecoder() {
+    switch (state.mode) {
+    case Variant::CHIP8: decoder = &Chip8CPU::decodeAs<Variant::CHIP8>; break;
+    case Variant::SCHIP: decoder = &Chip8CPU::decodeAs<Variant::SCHIP>; break;
+    case Variant::XOCHIP: decoder = &Chip8CPU::decodeAs<Variant::XOCHIP>; break;
+    }
+}
+
+template <Chip8CPU::Variant V>
+Chip8CPU::Instruction Chip8CPU::decodeAs(uint16_t opcode) const {
+    constexpr bool extended = (V == Variant::SCHIP || V == Variant::XOCHIP);
+    constexpr bool xochip = (V == Variant::XOCHIP);
+    constexpr bool resetVF = (V == Variant::CHIP8);
+    Instruction in;
+    in.opcode = opcode;
+    in.nnn = opcode & 0x0FFF;
+    in.nn = opcode & 0x00FF;
+    in.x = (opcode & 0x0F00) >> 8;
+    in.y = (opcode & 0x00F0) >> 4;
+    in.n = opcode & 0x000F;
+    in.handler = &Chip8CPU::opNop;
+
+    switch (opcode >> 12) {
     case 0x0:
-        switch (opcode) {
-        case 0x00E0:
-            disp.clear();
-            break;
-        case 0x00EE:
-            regs.PC() = regs.pop();
-            break;
-        default:
-            break;
+        if (extended && (opcode & 0xFFF0) == 0x00C0) in.handler = &Chip8CPU::op00CN<V>;
+        else if (xochip && (opcode & 0xFFF0) == 0x00D0) in.handler = &Chip8CPU::op00DN;
+        else if (extended && opcode == 0x00FB) in.handler = &Chip8CPU::op00FB;
+        else if (extended && opcode == 0x00FC) in.handler = &Chip8CPU::op00FC;
+        else if (extended && opcode == 0x00FE) in.handler = &Chip8CPU::op00FE;
+        else if (extended && opcode == 0x00FF) in.handler = &Chip8CPU::op00FF;
+        else if (opcode == 0x00E0) in.handler = &Chip8CPU::op00E0;
+        else if (opcode == 0x00EE) {
+            in.handler = &Chip8CPU::op00EE;
+            in.endsBlock = true;
         }
         break;
-    case 0x1:
-        regs.PC() = nnn;
-        break;
-    case 0x2:
-        regs.push(regs.PC());
-        regs.PC() = nnn;
-        break;
-    case 0x3:
-        if (regs.V(x) == nn) regs.PC() += 2;
-        break;
-    case 0x4:
-        if (regs.V(x) != nn) regs.PC() += 2;
-        break;
+    case 0x1: in.handler = &Chip8CPU::op1NNN; in.endsBlock = true; break;
+    case 0x2: in.handler = &Chip8CPU::op2NNN; in.endsBlock = true; break;
+    case 0x3: in.handler = &Chip8CPU::op3XNN; in.endsBlock = true; break;
+    case 0x4: in.handler = &Chip8CPU::op4XNN; in.endsBlock = true; break;
     case 0x5:
-        if (n4 == 0 && regs.V(x) == regs.V(y)) regs.PC() += 2;
-        else if (n4 == 2 && mode == Variant::XOCHIP) {
-            uint8_t tmp = regs.V(x);
-            regs.V(x) = regs.V(y);
-            regs.V(y) = tmp;
-        }
-        else if (n4 == 3 && mode == Variant::XOCHIP) {
-            regs.V(y) = regs.V(x);
-            regs.V(x) = 0;
+        if (in.n == 0) {
+            in.handler = &Chip8CPU::op5XY0;
+            in.endsBlock = true;
         }
+        else if (in.n == 2 && xochip) in.handler = &Chip8CPU::op5XY2;
+        else if (in.n == 3 && xochip) in.handler = &Chip8CPU::op5XY3;
         break;
-    case 0x6:
-        regs.V(x) = nn;
-        break;
-    case 0x7:
-        regs.V(x) = (regs.V(x) + nn) & 0xFF;
-        break;
+    case 0x6: in.handler = &Chip8CPU::op6XNN; break;
+    case 0x7: in.handler = &Chip8CPU::op7XNN; break;
     case 0x8:
-        switch (n4) {
-        case 0x0:
-            regs.V(x) = regs.V(y);
-            break;
-        case 0x1:
-            regs.V(x) |= regs.V(y);
-            if (mode == Variant::CHIP8) regs.V(0xF) = 0;
-            break;
-        case 0x2:
-            regs.V(x) &= regs.V(y);
-            if (mode == Variant::CHIP8) regs.V(0xF) = 0;
-            break;
-        case 0x3:
-            regs.V(x) ^= regs.V(y);
-            if (mode == Variant::CHIP8) regs.V(0xF) = 0;
-            break;
-        case 0x4: {
-            uint8_t vx = regs.V(x);
-            uint8_t vy = regs.V(y);
-            uint16_t sum = vx + vy;
-            uint8_t result = sum & 0xFF;
-            uint8_t vf = (sum > 0xFF) ? 1 : 0;
-            regs.V(x) = result;
-            regs.V(0xF) = vf;
-            break;
-        }
-        case 0x5: {
-            uint8_t vx = regs.V(x);
-            uint8_t vy = regs.V(y);
-            uint8_t result = (vx - vy) & 0xFF;
-            uint8_t vf = (vx >= vy) ? 1 : 0;
-            regs.V(x) = result;
-            regs.V(0xF) = vf;
-            break;
-        }
-        case 0x6: {
-            uint8_t vx = regs.V(x);
-            uint8_t vy = regs.V(y);
-            uint8_t src = quirks.shiftUsesVy ? vy : vx;
-            uint8_t result = src >> 1;
-            uint8_t vf = src & 0x1;
-            regs.V(x) = result;
-            regs.V(0xF) = vf;
-            break;
-        }
-        case 0x7: {
-            uint8_t vx = regs.V(x);
-            uint8_t vy = regs.V(y);
-            uint8_t result = (vy - vx) & 0xFF;
-            uint8_t vf = (vy >= vx) ? 1 : 0;
-            regs.V(x) = result;
-            regs.V(0xF) = vf;
+        switch (in.n) {
+        case 0x0: in.handler = &Chip8CPU::op8XY0; break;
+        case 0x1: in.handler = &Chip8CPU::op8XY1<resetVF>; break;
+        case 0x2: in.handler = &Chip8CPU::op8XY2<resetVF>; break;
+        case 0x3: in.handler = &Chip8CPU::op8XY3<resetVF>; break;
+        case 0x4: in.handler = &Chip8CPU::op8XY4; break;
+        case 0x5: in.handler = &Chip8CPU::op8XY5; break;
+        case 0x6:
+            in.handler = state.quirks.shiftUsesVy ? &Chip8CPU::op8XY6<true> : &Chip8CPU::op8XY6<false>;
             break;
-        }
-        case 0xE: {
-            uint8_t vx = regs.V(x);
-            uint8_t vy = regs.V(y);
-            uint8_t src = quirks.shiftUsesVy ? vy : vx;
-            uint8_t result = (src << 1) & 0xFF;
-            uint8_t vf = (src & 0x80) >> 7;
-            regs.V(x) = result;
-            regs.V(0xF) = vf;
+        case 0x7: in.handler = &Chip8CPU::op8XY7; break;
+        case 0xE:
+            in.handler = state.quirks.shiftUsesVy ? &Chip8CPU::op8XYE<true> : &Chip8CPU::op8XYE<false>;
             break;
         }
-        }
         break;
     case 0x9:
-        if (n4 == 0 && regs.V(x) != regs.V(y)) regs.PC() += 2;
-        break;
-    case 0xA:
-        regs.I() = nnn;
+        if (in.n == 0) {
+            in.handler = &Chip8CPU::op9XY0;
+            in.endsBlock = true;
+        }
         break;
+    case 0xA: in.handler = &Chip8CPU::opANNN; break;
     case 0xB:
-        regs.PC() = nnn + (quirks.jumpWithVx ? regs.V(x) : regs.V(0));
+        in.handler = state.quirks.jumpWithVx ? &Chip8CPU::opBNNN<true> : &Chip8CPU::opBNNN<false>;
+        in.endsBlock = true;
         break;
-    case 0xC:
-        regs.V(x) = dis(gen) & nn;
+    case 0xC: in.handler = &Chip8CPU::opCXNN; break;
+    case 0xD:
+        if (extended && in.n == 0) in.handler = &Chip8CPU::opDXY0;
+        else in.handler = state.quirks.displayWait ? &Chip8CPU::opDXYN<V, true> : &Chip8CPU::opDXYN<V, false>;
+        in.endsBlock = true;
         break;
-    case 0xD: {
-        uint8_t vx = regs.V(x);
-        uint8_t vy = regs.V(y);
-        uint8_t n = n4;
-        bool collision = false;
-        static auto lastDraw = std::chrono::high_resolution_clock::now();
-        auto now = std::chrono::high_resolution_clock::now();
-        double elapsed = std::chrono::duration<double>(now - lastDraw).count();
-        if (elapsed < (1.0 / 60.0)) {
-            regs.PC() -= 2;
-            break;
-        }
-        lastDraw = now;
-        if (mode == Variant::CHIP8) {
-            int w = disp.width();
-            int h = disp.height();
-            int startX = vx % w;
-            int startY = vy % h;
-            for (uint8_t row = 0; row < n; ++row) {
-                uint8_t spriteByte = mem.read(regs.I() + row);
-                int py = startY + row;
-                if (py >= h) continue;
-                for (uint8_t col = 0; col < 8; ++col) {
-                    int px = startX + col;
-                    if (px >= w) continue;
-                    if ((spriteByte & (0x80 >> col)) != 0) {
-                        if (disp.getPixel(px, py)) collision = true;
-                        disp.setPixel(px, py, disp.getPixel(px, py) ^ 1);
-                    }
-                }
-            }
-        } else {
-            if (mode == Variant::SCHIP) {
-                int w = disp.width();
-                int h = disp.height();
-                int startX = vx & (w - 1);
-                int startY = vy & (h - 1);
-                for (uint8_t row = 0; row < n; ++row) {
-                    uint8_t spriteByte = mem.read(regs.I() + row);
-                    int py = startY + row;
-                    if (py >= h) continue;
-                    for (uint8_t col = 0; col < 8; ++col) {
-                        int px = startX + col;
-                        if (px >= w) continue;
-                        if ((spriteByte & (0x80 >> col)) != 0) {
-                            if (disp.getPixel(px, py)) collision = true;
-                            disp.setPixel(px, py, disp.getPixel(px, py) ^ 1);
-                        }
-                    }
-                }
-            } else {
-                collision = disp.drawSprite(vx, vy, mem.data() + regs.I(), n);
-            }
-        }
-        regs.V(0xF) = collision ? 1 : 0;
-        break;
-    }
     case 0xE:
-        switch (nn) {
-        case 0x9E:
-            if (inp.isPressed(regs.V(x))) regs.PC() += 2;
-            break;
-        case 0xA1:
-            if (!inp.isPressed(regs.V(x))) regs.PC() += 2;
-            break;
+        if (in.nn == 0x9E) {
+            in.handler = &Chip8CPU::opEX9E;
+            in.endsBlock = true;
+        } else if (in.nn == 0xA1) {
+            in.handler = &Chip8CPU::opEXA1;
+            in.endsBlock = true;
         }
         break;
     case 0xF:
-        switch (nn) {
-        case 0x07:
-            regs.V(x) = tmr.getDelay();
-            break;
-        case 0x0A: {
-            static bool waitingForRelease = false;
-            static int lastKey = -1;
-            int key = inp.getPressedKey();
-            if (!waitingForRelease) {
-                if (key == -1) {
-                    regs.PC() -= 2;
-                } else {
-                    regs.V(x) = key;
-                    waitingForRelease = true;
-                    lastKey = key;
-                    regs.PC() -= 2;
-                }
-            } else {
-                if (key == lastKey) {
-                    regs.PC() -= 2;
-                } else {
-                    waitingForRelease = false;
-                    lastKey = -1;
-                }
-            }
-            break;
-        }
-        case 0x15:
-            tmr.setDelay(regs.V(x));
-            break;
-        case 0x18:
-            tmr.setSound(regs.V(x));
-            break;
-        case 0x1E:
-            regs.I() = (regs.I() + regs.V(x)) & 0xFFFF;
-            break;
-        case 0x29:
-            regs.I() = Chip8Memory::FONTSET_START + (regs.V(x) & 0xF) * 5;
-            break;
-        case 0x33: {
-            uint8_t value = regs.V(x);
-            mem.write(regs.I(), value / 100);
-            mem.write(regs.I() + 1, (value / 10) % 10);
-            mem.write(regs.I() + 2, value % 10);
-            break;
-        }
+        switch (in.nn) {
+        case 0x07: in.handler = &Chip8CPU::opFX07; break;
+        case 0x0A: in.handler = &Chip8CPU::opFX0A; in.endsBlock = true; break;
+        case 0x15: in.handler = &Chip8CPU::opFX15; break;
+        case 0x18: in.handler = &Chip8CPU::opFX18; break;
+        case 0x1E: in.handler = &Chip8CPU::opFX1E; break;
+        case 0x29: in.handler = &Chip8CPU::opFX29; break;
+        case 0x33: in.handler = &Chip8CPU::opFX33; break;
         case 0x55:
-            for (uint8_t i = 0; i <= x; ++i) mem.write(regs.I() + i, regs.V(i));
-            if (quirks.loadStoreIncrementI) regs.I() += x + 1;
+            in.handler = state.quirks.loadStoreIncrementI ? &Chip8CPU::opFX55<true> : &Chip8CPU::opFX55<false>;
             break;
         case 0x65:
-            for (uint8_t i = 0; i <= x; ++i) regs.V(i) = mem.read(regs.I() + i);
-            if (quirks.loadStoreIncrementI) regs.I() += x + 1;
-            break;
-        case 0x01:
-            if (mode == Variant::XOCHIP) {
-                disp.setActivePlanes(regs.V(x));
-            }
+            in.handler = state.quirks.loadStoreIncrementI ? &Chip8CPU::opFX65<true> : &Chip8CPU::opFX65<false>;
             break;
-        if ((opcode & 0xFFF0) == 0x00D0 && mode == Variant::XOCHIP) {
-            uint8_t n = opcode & 0x000F;
-            if (n < 16) {
-                snd.playPattern(&audioBuffer[n * 16]);
-            }
+        case 0x01: if (xochip) in.handler = &Chip8CPU::opFX01; break;
+        case 0x75: if (xochip) in.handler = &Chip8CPU::opFX75; break;
+        case 0x85: if (xochip) in.handler = &Chip8CPU::opFX85; break;
+        }
+        break;
+    }
+    return in;
+}
+
+void Chip8CPU::opNop(const Instruction&) {}
+void Chip8CPU::opBadPC(const Instruction&) { state.fault = Fault::AddressOutOfRange; }
+
+template <Chip8CPU::Variant V>
+void Chip8CPU::op00CN(const Instruction& in) {
+    int lines = 0;
+    if constexpr (V == Variant::XOCHIP) {
+        lines = (state.disp.getMode() == Chip8Display::Mode::LowRes) ? in.n : in.n * 2;
+    } else {
+        lines = in.n;
+    }
+    state.disp.scrollDown(lines);
+}
+
+// XO-CHIP scroll up; counts lines like 00CN
+void Chip8CPU::op00DN(const Instruction& in) {
+    int lines = (state.disp.getMode() == Chip8Display::Mode::LowRes) ? in.n : in.n * 2;
+    state.disp.scrollUp(lines);
+}
+
+void Chip8CPU::op00E0(const Instruction&) { state.disp.clear(); }
+void Chip8CPU::op00EE(const Instruction&) {
+    uint16_t address = 0;
+    if (!state.regs.pop(address)) {
+        state.fault = Fault::StackUnderflow;
+        return;
+    }
+    state.regs.PC() = address;
+}
+void Chip8CPU::op00FB(const Instruction&) { state.disp.scrollRight(); }
+void Chip8CPU::op00FC(const Instruction&) { state.disp.scrollLeft(); }
+void Chip8CPU::op00FE(const Instruction&) { state.disp.setMode(Chip8Display::Mode::LowRes); }
+void Chip8CPU::op00FF(const Instruction&) { state.disp.setMode(Chip8Display::Mode::HighRes); }
+
+void Chip8CPU::op1NNN(const Instruction& in) { state.regs.PC() = in.nnn; }
+
+void Chip8CPU::op2NNN(const Instruction& in) {
+    if (!state.regs.push(state.regs.PC())) {
+        state.fault = Fault::StackOverflow;
+        return;
+    }
+    state.regs.PC() = in.nnn;
+}
+
+void Chip8CPU::op3XNN(const Instruction& in) {
+    if (state.regs.V(in.x) == in.nn) state.regs.PC() += 2;
+}
+
+void Chip8CPU::op4XNN(const Instruction& in) {
+    if (state.regs.V(in.x) != in.nn) state.regs.PC() += 2;
+}
+
+void Chip8CPU::op5XY0(const Instruction& in) {
+    if (state.regs.V(in.x) == state.regs.V(in.y)) state.regs.PC() += 2;
+}
+
+void Chip8CPU::op5XY2(const Instruction& in) {
+    uint8_t tmp = state.regs.V(in.x);
+    state.regs.V(in.x) = state.regs.V(in.y);
+    state.regs.V(in.y) = tmp;
+}
+
+void Chip8CPU::op5XY3(const Instruction& in) {
+    state.regs.V(in.y) = state.regs.V(in.x);
+    state.regs.V(in.x) = 0;
+}
+
+void Chip8CPU::op6XNN(const Instruction& in) { state.regs.V(in.x) = in.nn; }
+
+void Chip8CPU::op7XNN(const Instruction& in) {
+    state.regs.V(in.x) = (state.regs.V(in.x) + in.nn) & 0xFF;
+}
+
+void Chip8CPU::op8XY0(const Instruction& in) { state.regs.V(in.x) = state.regs.V(in.y); }
+
+template <bool ResetVF>
+void Chip8CPU::op8XY1(const Instruction& in) {
+    state.regs.V(in.x) |= state.regs.V(in.y);
+    if constexpr (ResetVF) state.regs.V(0xF) = 0;
+}
+
+template <bool ResetVF>
+void Chip8CPU::op8XY2(const Instruction& in) {
+    state.regs.V(in.x) &= state.regs.V(in.y);
+    if constexpr (ResetVF) state.regs.V(0xF) = 0;
+}
+
+template <bool ResetVF>
+void Chip8CPU::op8XY3(const Instruction& in) {
+    state.regs.V(in.x) ^= state.regs.V(in.y);
+    if constexpr (ResetVF) state.regs.V(0xF) = 0;
+}
+
+void Chip8CPU::op8XY4(const Instruction& in) {
+    uint16_t sum = state.regs.V(in.x) + state.regs.V(in.y);
+    state.regs.V(in.x) = sum & 0xFF;
+    state.regs.V(0xF) = (sum > 0xFF) ? 1 : 0;
+}
+
+void Chip8CPU::op8XY5(const Instruction& in) {
+    uint8_t vx = state.regs.V(in.x);
+    uint8_t vy = state.regs.V(in.y);
+    state.regs.V(in.x) = (vx - vy) & 0xFF;
+    state.regs.V(0xF) = (vx >= vy) ? 1 : 0;
+}
+
+template <bool ShiftUsesVy>
+void Chip8CPU::op8XY6(const Instruction& in) {
+    uint8_t src = ShiftUsesVy ? state.regs.V(in.y) : state.regs.V(in.x);
+    state.regs.V(in.x) = src >> 1;
+    state.regs.V(0xF) = src & 0x1;
+}
+
+void Chip8CPU::op8XY7(const Instruction& in) {
+    uint8_t vx = state.regs.V(in.x);
+    uint8_t vy = state.regs.V(in.y);
+    state.regs.V(in.x) = (vy - vx) & 0xFF;
+    state.regs.V(0xF) = (vy >= vx) ? 1 : 0;
+}
+
+template <bool ShiftUsesVy>
+void Chip8CPU::op8XYE(const Instruction& in) {
+    uint8_t src = ShiftUsesVy ? state.regs.V(in.y) : state.regs.V(in.x);
+    state.regs.V(in.x) = (src << 1) & 0xFF;
+    state.regs.V(0xF) = (src & 0x80) >> 7;
+}
+
+void Chip8CPU::op9XY0(const Instruction& in) {
+    if (state.regs.V(in.x) != state.regs.V(in.y)) state.regs.PC() += 2;
+}
+
+void Chip8CPU::opANNN(const Instruction& in) { state.regs.I() = in.nnn; }
+
+template <bool JumpWithVx>
+void Chip8CPU::opBNNN(const Instruction& in) {
+    state.regs.PC() = in.nnn + (JumpWithVx ? state.regs.V(in.x) : state.regs.V(0));
+}
+
+void Chip8CPU::opCXNN(const Instruction& in) {
+    state.regs.V(in.x) = nextRandom() & in.nn;
+}
+
+template <Chip8CPU::Variant V, bool DisplayWait>
+void Chip8CPU::opDXYN(const Instruction& in) {
+    if constexpr (DisplayWait) {
+        // One draw per emulated frame; re-executed once the frame counter moves on
+        if (state.lastDrawFrame == state.frameCount) {
+            state.regs.PC() -= 2;
             return;
         }
-        case 0x75:
-            if (mode == Variant::XOCHIP) {
-                for (uint8_t i = 0; i <= x; ++i) {
-                    audioBuffer[i] = regs.V(i);
-                }
-            }
-            break;
-        case 0x85:
-            if (mode == Variant::XOCHIP) {
-                for (uint8_t i = 0; i <= x; ++i) {
-                    regs.V(i) = audioBuffer[i];
-                }
+        state.lastDrawFrame = state.frameCount;
+    }
+    uint8_t n = in.n;
+    if (!checkRange(state.regs.I(), n)) return;
+    uint8_t vx = state.regs.V(in.x);
+    uint8_t vy = state.regs.V(in.y);
+    const uint8_t* sprite = state.mem.data() + state.regs.I();
+    if constexpr (V == Variant::XOCHIP) {
+        state.regs.V(0xF) = state.disp.drawSprite(vx, vy, sprite, n) ? 1 : 0;
+    } else {
+        auto result = state.disp.blit<Chip8Display::SpriteEdge::Clip, 8, 1>(vx, vy, sprite, n);
+        state.regs.V(0xF) = (V == Variant::SCHIP) ? schipCollisionFlag(result) : (result.collision ? 1 : 0);
+    }
+}
+
+// SCHIP/XO-CHIP 16x16 sprite (DXY0)
+void Chip8CPU::opDXY0(const Instruction& in) {
+    if (!checkRange(state.regs.I(), 32)) return;
+    const uint8_t* sprite = state.mem.data() + state.regs.I();
+    auto result = state.disp.blit<Chip8Display::SpriteEdge::Wrap, 16, 1>(state.regs.V(in.x), state.regs.V(in.y), sprite, 16);
+    state.regs.V(0xF) = (state.mode == Variant::SCHIP) ? schipCollisionFlag(result) : (result.collision ? 1 : 0);
+}
+
+// SCHIP 1.1 behaviour; DXY0 wraps here, so only DXYN has clipped rows
+uint8_t Chip8CPU::schipCollisionFlag(const Chip8Display::BlitResult& result) const {
+    if (state.disp.getMode() != Chip8Display::Mode::HighRes) return result.collision ? 1 : 0;
+    return static_cast<uint8_t>(result.collidedRows + result.clippedRows);
+}
+
+void Chip8CPU::opEX9E(const Instruction& in) {
+    if (state.inp.isPressed(state.regs.V(in.x))) state.regs.PC() += 2;
+}
+
+void Chip8CPU::opEXA1(const Instruction& in) {
+    if (!state.inp.isPressed(state.regs.V(in.x))) state.regs.PC() += 2;
+}
+
+void Chip8CPU::opFX01(const Instruction& in) { state.disp.setActivePlanes(state.regs.V(in.x)); }
+void Chip8CPU::opFX07(const Instruction& in) { state.regs.V(in.x) = state.tmr.getDelay(); }
+
+void Chip8CPU::opFX0A(const Instruction& in) {
+    int key = state.inp.getPressedKey();
+    if (!state.keyWaitRelease) {
+        if (key == -1) {
+            state.regs.PC() -= 2;
+        } else {
+            state.regs.V(in.x) = key;
+            state.keyWaitRelease = true;
+            state.keyWaitKey = key;
+            state.regs.PC() -= 2;
+        }
+    } else {
+        if (key == state.keyWaitKey) {
+            state.regs.PC() -= 2;
+        } else {
+            state.keyWaitRelease = false;
+            state.keyWaitKey = -1;
+        }
+    }
+}
+
+void Chip8CPU::opFX15(const Instruction& in) { state.tmr.setDelay(state.regs.V(in.x)); }
+void Chip8CPU::opFX18(const Instruction& in) { state.tmr.setSound(state.regs.V(in.x)); }
+
+void Chip8CPU::opFX1E(const Instruction& in) {
+    state.regs.I() = (state.regs.I() + state.regs.V(in.x)) & 0xFFFF;
+}
+
+void Chip8CPU::opFX29(const Instruction& in) {
+    state.regs.I() = Chip8Memory::FONTSET_START + (state.regs.V(in.x) & 0xF) * 5;
+}
+
+void Chip8CPU::opFX33(const Instruction& in) {
+    if (!checkRange(state.regs.I(), 3)) return;
+    uint8_t value = state.regs.V(in.x);
+    writeMemory(state.regs.I(), value / 100);
+    writeMemory(state.regs.I() + 1, (value / 10) % 10);
+    writeMemory(state.regs.I() + 2, value % 10);
+}
+
+template <bool IncrementI>
+void Chip8CPU::opFX55(const Instruction& in) {
+    if (!checkRange(state.regs.I(), in.x + 1)) return;
+    for (uint8_t i = 0; i <= in.x; ++i) writeMemory(state.regs.I() + i, state.regs.V(i));
+    if constexpr (IncrementI) state.regs.I() += in.x + 1;
+}
+
+template <bool IncrementI>
+void Chip8CPU::opFX65(const Instruction& in) {
+    if (!checkRange(state.regs.I(), in.x + 1)) return;
+    for (uint8_t i = 0; i <= in.x; ++i) state.regs.V(i) = state.mem.read(state.regs.I() + i);
+    if constexpr (IncrementI) state.regs.I() += in.x + 1;
+}
+
+void Chip8CPU::opFX75(const Instruction& in) {
+    for (uint8_t i = 0; i <= in.x; ++i) {
+        state.audioBuffer[i] = state.regs.V(i);
+    }
+}
+
+void Chip8CPU::opFX85(const Instruction& in) {
+    for (uint8_t i = 0; i <= in.x; ++i) {
+        state.regs.V(i) = state.audioBuffer[i];
+    }
+}
+
+namespace {
+    // Save-state chunks (see chip8_savestate.h for the container)
+    constexpr uint32_t CHUNK_CPU = Chip8SaveState::chunkId("CPU ");  // Variant, quirks, counters, PRNG
+    constexpr uint32_t CHUNK_REGS = Chip8SaveState::chunkId("REGS"); // Registers, stack, timers, keypad
+    constexpr uint32_t CHUNK_MEM = Chip8SaveState::chunkId("MEM ");  // Memory up to the variant's size
+    constexpr uint32_t CHUNK_DISP = Chip8SaveState::chunkId("DISP"); // Display modes and bitplanes
+    constexpr uint32_t CHUNK_AUDIO = Chip8SaveState::chunkId("AUDI"); // Pattern buffer and buzzer
+
+    // Bitplanes are stored as rows of 16 bytes, leftmost pixel in the high bit
+    constexpr size_t PLANE_ROW_BYTES = Chip8Display::HIRES_WIDTH / 8;
+}
+
+void Chip8CPU::saveState(std::vector<uint8_t>& out) const {
+    Chip8SaveState::Writer w;
+    w.beginChunk(CHUNK_CPU);
+    w.u8(static_cast<uint8_t>(state.mode));
+    w.u8(static_cast<uint8_t>(state.quirks.shiftUsesVy | state.quirks.loadStoreIncrementI << 1 |
+                              state.quirks.jumpWithVx << 2 | state.quirks.displayWait << 3));
+    w.u8(static_cast<uint8_t>(state.fault));
+    w.u8(state.keyWaitRelease);
+    w.u8(static_cast<uint8_t>(state.keyWaitKey)); // 0xFF = none
+    w.u32(static_cast<uint32_t>(state.cyclesPerFrame));
+    w.u32(static_cast<uint32_t>(state.frameCycles));
+    w.u64(state.cycleCount);
+    w.u64(state.frameCount);
+    w.u64(state.skippedCycles);
+    w.u64(state.lastDrawFrame);
+    w.u64(state.rngSeed);
+    w.u64(state.rngState);
+    w.endChunk();
+
+    w.beginChunk(CHUNK_REGS);
+    w.bytes(state.regs.getV().data(), state.regs.getV().size());
+    w.u16(state.regs.I());
+    w.u16(state.regs.PC());
+    w.u8(state.regs.SP());
+    for (uint16_t entry : state.regs.getStack()) w.u16(entry);
+    w.u8(state.tmr.getDelay());
+    w.u8(state.tmr.getSound());
+    uint16_t keys = 0;
+    for (size_t k = 0; k < Chip8Input::NUM_KEYS; ++k) keys |= uint16_t(state.inp.isPressed(static_cast<uint8_t>(k))) << k;
+    w.u16(keys);
+    w.endChunk();
+
+    w.beginChunk(CHUNK_MEM);
+    w.bytes(state.mem.data(), state.mem.size());
+    w.endChunk();
+
+    w.beginChunk(CHUNK_DISP);
+    w.u8(static_cast<uint8_t>(state.disp.mode));
+    w.u8(static_cast<uint8_t>(state.disp.colorMode));
+    w.u8(state.disp.activePlanes);
+    for (const auto& plane : state.disp.planes) {
+        for (const auto& row : plane) {
+            for (uint64_t word : row) {
+                for (int byte = 7; byte >= 0; --byte) w.u8(static_cast<uint8_t>(word >> (8 * byte)));
             }
-            break;
         }
-        break;
-    default:
-        break;
     }
+    w.endChunk();
+
+    w.beginChunk(CHUNK_AUDIO);
+    w.bytes(state.audioBuffer.data(), state.audioBuffer.size());
+    w.u8(snd.isOn());
+    w.u8(snd.getPlaying());
+    w.u32(static_cast<uint32_t>(snd.getPhase()));
+    w.endChunk();
+    out = w.data();
 }
 
 bool Chip8CPU::saveState(const std::string& path) const {
+    std::vector<uint8_t> data;
+    saveState(data);
     std::ofstream out(path, std::ios::binary);
     if (!out) return false;
-    int modeInt = static_cast<int>(mode);
-    out.write(reinterpret_cast<const char*>(&modeInt), sizeof(modeInt));
-    out.write(reinterpret_cast<const char*>(&quirks), sizeof(quirks));
-    size_t memSize = mem.size();
-    out.write(reinterpret_cast<const char*>(&memSize), sizeof(memSize));
-    out.write(reinterpret_cast<const char*>(mem.data()), memSize);
-    out.write(reinterpret_cast<const char*>(regs.getV().data()), regs.getV().size());
-    out.write(reinterpret_cast<const char*>(&regs.I()), sizeof(uint16_t));
-    out.write(reinterpret_cast<const char*>(&regs.PC()), sizeof(uint16_t));
-    out.write(reinterpret_cast<const char*>(&regs.SP()), sizeof(uint8_t));
-    out.write(reinterpret_cast<const char*>(regs.getStack().data()), regs.getStack().size() * sizeof(uint16_t));
-    uint8_t delay = tmr.getDelay();
-    uint8_t sound = tmr.getSound();
-    out.write(reinterpret_cast<const char*>(&delay), sizeof(delay));
-    out.write(reinterpret_cast<const char*>(&sound), sizeof(sound));
-    out.write(reinterpret_cast<const char*>(inp.getKeys().data()), inp.getKeys().size());
-    for (const auto& row : disp.fb) {
-        out.write(reinterpret_cast<const char*>(row.data()), row.size());
-    }
-    int modeVal = static_cast<int>(disp.getMode());
-    int colorModeVal = static_cast<int>(disp.getColorMode());
-    uint8_t activePlanes = disp.getActivePlanes();
-    out.write(reinterpret_cast<const char*>(&modeVal), sizeof(modeVal));
-    out.write(reinterpret_cast<const char*>(&colorModeVal), sizeof(colorModeVal));
-    out.write(reinterpret_cast<const char*>(&activePlanes), sizeof(activePlanes));
-    int phase = snd.getPhase();
-    out.write(reinterpret_cast<const char*>(&phase), sizeof(phase));
-    bool muted = snd.getMuted();
-    out.write(reinterpret_cast<const char*>(&muted), sizeof(muted));
-    int volume = snd.getVolume();
-    out.write(reinterpret_cast<const char*>(&volume), sizeof(volume));
-    bool buzzer = snd.isOn();
-    out.write(reinterpret_cast<const char*>(&buzzer), sizeof(buzzer));
-    bool playing = snd.getPlaying();
-    out.write(reinterpret_cast<const char*>(&playing), sizeof(playing));
-    out.write(reinterpret_cast<const char*>(audioBuffer.data()), audioBuffer.size());
+    out.write(reinterpret_cast<const char*>(data.data()), data.size());
     return !!out;
 }
 
 bool Chip8CPU::loadState(const std::string& path) {
-    std::ifstream in(path, std::ios::binary);
-    if (!in) return false;
-    int modeInt = 0;
-    in.read(reinterpret_cast<char*>(&modeInt), sizeof(modeInt));
-    mode = static_cast<Variant>(modeInt);
-    in.read(reinterpret_cast<char*>(&quirks), sizeof(quirks));
-    size_t memSize = 0;
-    in.read(reinterpret_cast<char*>(&memSize), sizeof(memSize));
-    if (memSize != mem.size()) return false;
-    in.read(reinterpret_cast<char*>(mem.data()), memSize);
-    in.read(reinterpret_cast<char*>(regs.getV().data()), regs.getV().size());
-    in.read(reinterpret_cast<char*>(&regs.I()), sizeof(uint16_t));
-    in.read(reinterpret_cast<char*>(&regs.PC()), sizeof(uint16_t));
-    in.read(reinterpret_cast<char*>(&regs.SP()), sizeof(uint8_t));
-    in.read(reinterpret_cast<char*>(regs.getStack().data()), regs.getStack().size() * sizeof(uint16_t));
-    uint8_t delay = 0, sound = 0;
-    in.read(reinterpret_cast<char*>(&delay), sizeof(delay));
-    in.read(reinterpret_cast<char*>(&sound), sizeof(sound));
-    tmr.setDelay(delay);
-    tmr.setSound(sound);
-    in.read(reinterpret_cast<char*>(inp.getKeys().data()), inp.getKeys().size());
-    for (auto& row : disp.fb) {
-        in.read(reinterpret_cast<char*>(row.data()), row.size());
-    }
-    int modeVal = 0, colorModeVal = 0;
-    uint8_t activePlanes = 0;
-    in.read(reinterpret_cast<char*>(&modeVal), sizeof(modeVal));
-    in.read(reinterpret_cast<char*>(&colorModeVal), sizeof(colorModeVal));
-    in.read(reinterpret_cast<char*>(&activePlanes), sizeof(activePlanes));
-    disp.mode = static_cast<Chip8Display::Mode>(modeVal);
-    disp.colorMode = static_cast<Chip8Display::ColorMode>(colorModeVal);
-    disp.activePlanes = activePlanes;
+    Chip8SaveState::MappedFile file(path);
+    return file.isOpen() && loadState(file.data(), file.size());
+}
+
+bool Chip8CPU::loadState(const uint8_t* data, size_t size) {
+    Chip8SaveState::Reader reader;
+    if (!reader.open(data, size)) return false;
+    Chip8SaveState::ChunkReader cpu, regs, mem, disp, audio;
+    if (!reader.find(CHUNK_CPU, cpu) || !reader.find(CHUNK_REGS, regs) ||
+        !reader.find(CHUNK_MEM, mem) || !reader.find(CHUNK_DISP, disp)) return false;
+
+    // Decode and validate everything before the CPU is touched
+    uint8_t variant = cpu.u8();
+    uint8_t quirkBits = cpu.u8();
+    uint8_t fault = cpu.u8();
+    bool keyWaitRelease = cpu.u8() != 0;
+    int keyWaitKey = static_cast<int8_t>(cpu.u8());
+    int cyclesPerFrame = static_cast<int32_t>(cpu.u32());
+    int frameCycles = static_cast<int32_t>(cpu.u32());
+    uint64_t cycleCount = cpu.u64();
+    uint64_t frameCount = cpu.u64();
+    uint64_t skippedCycles = cpu.u64();
+    uint64_t lastDrawFrame = cpu.u64();
+    uint64_t rngSeed = cpu.u64();
+    uint64_t rngState = cpu.u64();
+    if (!cpu.ok() || variant > static_cast<uint8_t>(Variant::XOCHIP) ||
+        fault > static_cast<uint8_t>(Fault::AddressOutOfRange) || keyWaitKey < -1 ||
+        keyWaitKey >= static_cast<int>(Chip8Input::NUM_KEYS) || cyclesPerFrame < 1 ||
+        frameCycles < 0 || frameCycles >= cyclesPerFrame || rngState == 0) return false;
+    Variant newMode = static_cast<Variant>(variant);
+
+    Chip8Registers newRegs;
+    const uint8_t* v = regs.bytes(newRegs.getV().size());
+    if (v) std::memcpy(newRegs.getV().data(), v, newRegs.getV().size());
+    newRegs.I() = regs.u16();
+    newRegs.PC() = regs.u16();
+    newRegs.SP() = regs.u8();
+    for (auto& entry : newRegs.getStack()) entry = regs.u16();
+    Chip8Timers newTimers;
+    newTimers.setDelay(regs.u8());
+    newTimers.setSound(regs.u8());
+    uint16_t keys = regs.u16();
+    if (!regs.ok() || newRegs.SP() > newRegs.getStack().size()) return false;
+
+    // Memory is copied straight from the file into the state block
+    size_t memSize = memorySizeFor(newMode);
+    const uint8_t* memory = mem.bytes(memSize);
+    if (!memory || mem.size() != memSize) return false;
+
+    uint8_t dispMode = disp.u8();
+    uint8_t colorMode = disp.u8();
+    uint8_t activePlanes = disp.u8();
+    const uint8_t* planes = disp.bytes(Chip8Display::XOCHIP_PLANES * Chip8Display::HIRES_HEIGHT * PLANE_ROW_BYTES);
+    if (!planes || dispMode > static_cast<uint8_t>(Chip8Display::Mode::HighRes) ||
+        colorMode > static_cast<uint8_t>(Chip8Display::ColorMode::XOCHIP_2BPP) ||
+        activePlanes > (1 << Chip8Display::XOCHIP_PLANES) - 1) return false;
+
+    // Older writers may omit the audio chunk; the buzzer then follows the sound timer
+    const uint8_t* pattern = nullptr;
+    bool buzzer = newTimers.getSound() > 0, playing = false;
     int phase = 0;
-    in.read(reinterpret_cast<char*>(&phase), sizeof(phase));
+    if (reader.find(CHUNK_AUDIO, audio)) {
+        pattern = audio.bytes(state.audioBuffer.size());
+        buzzer = audio.u8() != 0;
+        playing = audio.u8() != 0;
+        phase = static_cast<int32_t>(audio.u32());
+        if (!audio.ok()) return false;
+    }
+
+    size_t oldSize = state.mem.size();
+    state.mode = newMode;
+    state.quirks.shiftUsesVy = quirkBits & 1;
+    state.quirks.loadStoreIncrementI = (quirkBits >> 1) & 1;
+    state.quirks.jumpWithVx = (quirkBits >> 2) & 1;
+    state.quirks.displayWait = (quirkBits >> 3) & 1;
+    state.fault = static_cast<Fault>(fault);
+    state.cyclesPerFrame = cyclesPerFrame;
+    state.frameCycles = frameCycles;
+    state.cycleCount = cycleCount;
+    state.frameCount = frameCount;
+    state.skippedCycles = skippedCycles;
+    state.lastDrawFrame = lastDrawFrame;
+    state.rngSeed = rngSeed;
+    state.rngState = rngState;
+    state.keyWaitRelease = keyWaitRelease;
+    state.keyWaitKey = keyWaitKey;
+    state.regs = newRegs;
+    state.tmr = newTimers;
+    for (size_t k = 0; k < Chip8Input::NUM_KEYS; ++k) state.inp.setKey(static_cast<uint8_t>(k), (keys >> k) & 1);
+
+    if (oldSize != memSize) {
+        state.mem.reset(memSize);
+        decodeCache.assign(memSize, Instruction{});
+        breakpoints.assign(memSize, false);
+        breakpointCount = 0;
+    }
+    std::memcpy(state.mem.data(), memory, memSize);
+    state.mem.markAllDirty();
+
+    uint64_t displayGeneration = state.disp.generation();
+    state.disp.mode = static_cast<Chip8Display::Mode>(dispMode);
+    state.disp.colorMode = static_cast<Chip8Display::ColorMode>(colorMode);
+    state.disp.activePlanes = activePlanes;
+    for (auto& plane : state.disp.planes) {
+        for (auto& row : plane) {
+            for (uint64_t& word : row) {
+                word = 0;
+                for (int byte = 0; byte < 8; ++byte) word = word << 8 | *planes++;
+            }
+        }
+    }
+    state.disp.markReplaced(displayGeneration);
+
+    if (pattern) std::memcpy(state.audioBuffer.data(), pattern, state.audioBuffer.size());
+    else state.audioBuffer.fill(0);
     snd.setPhase(phase);
-    bool muted = false;
-    in.read(reinterpret_cast<char*>(&muted), sizeof(muted));
-    snd.setMuted(muted);
-    int volume = 100;
-    in.read(reinterpret_cast<char*>(&volume), sizeof(volume));
-    snd.setVolume(volume);
-    bool buzzer = false;
-    in.read(reinterpret_cast<char*>(&buzzer), sizeof(buzzer));
     if (buzzer) snd.start(); else snd.stop();
-    bool playing = false;
-    in.read(reinterpret_cast<char*>(&playing), sizeof(playing));
     snd.setPlaying(playing);
-    in.read(reinterpret_cast<char*>(audioBuffer.data()), audioBuffer.size());
-    return !!in;
-} 
\ No newline at end of file
+
+    selectDecoder();
+    invalidateDecodeCache();
+    return true;
+}
+
+size_t Chip8CPU::stateHeaderSize() const {
+    return state.mem.data() - reinterpret_cast<const uint8_t*>(&state);
+}
+
+size_t Chip8CPU::snapshotSize() const {
+    return sizeof(SnapshotHeader) + stateHeaderSize() + state.mem.size();
+}
+
+size_t Chip8CPU::snapshotMemoryOffset() const {
+    return sizeof(SnapshotHeader) + stateHeaderSize();
+}
+
+std::vector<uint8_t> Chip8CPU::snapshot() const {
+    std::vector<uint8_t> blob(snapshotSize());
+    snapshot(blob.data(), blob.size());
+    return blob;
+}
+
+size_t Chip8CPU::snapshot(uint8_t* buffer, size_t capacity) const {
+    size_t size = snapshotSize();
+    if (capacity < size) return 0;
+    SnapshotHeader header{SNAPSHOT_MAGIC, static_cast<uint32_t>(state.mem.size())};
+    std::memcpy(buffer, &header, sizeof(header));
+    // State is trivially copyable and memory is its tail, so the used part is one prefix
+    std::memcpy(buffer + sizeof(header), &state, size - sizeof(header));
+    return size;
+}
+
+bool Chip8CPU::restore(const uint8_t* data, size_t size) {
+    SnapshotHeader header{};
+    if (!data || size < sizeof(header)) return false;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != SNAPSHOT_MAGIC) return false;
+    if (header.memorySize != Chip8Memory::CHIP8_MEMORY_SIZE &&
+        header.memorySize != Chip8Memory::SCHIP_MEMORY_SIZE &&
+        header.memorySize != Chip8Memory::XOCHIP_MEMORY_SIZE) return false;
+    size_t headerSize = stateHeaderSize();
+    if (size != sizeof(header) + headerSize + header.memorySize) return false;
+
+    Variant oldMode = state.mode;
+    Quirks oldQuirks = state.quirks;
+    size_t oldSize = state.mem.size();
+    const uint8_t* blobState = data + sizeof(header);
+    const uint8_t* blobMemory = blobState + headerSize;
+    // Same layout: only pages whose bytes differ need their decode entries flushed. Those
+    // pages and the ones already dirty stay dirty, so a clean page keeps matching whatever
+    // it matched before the restore (the blob's own dirty bits are not used)
+    bool sameSize = oldSize == header.memorySize;
+    bool partialInvalidate = decodeCacheEnabled && sameSize;
+    std::array<uint64_t, Chip8Memory::XOCHIP_MEMORY_SIZE / Chip8Memory::PAGE_SIZE / 64> written{};
+    if (sameSize) {
+        for (size_t page = 0; page < header.memorySize / Chip8Memory::PAGE_SIZE; ++page) {
+            size_t start = page * Chip8Memory::PAGE_SIZE;
+            bool differs = std::memcmp(state.mem.data() + start, blobMemory + start, Chip8Memory::PAGE_SIZE) != 0;
+            if (differs || state.mem.isPageDirty(page)) written[page / 64] |= uint64_t(1) << (page % 64);
+            if (!differs || !partialInvalidate) continue;
+            // The instruction starting on the byte before the page overlaps it
+            size_t first = start > 0 ? start - 1 : 0;
+            std::fill(decodeCache.begin() + first, decodeCache.begin() + start + Chip8Memory::PAGE_SIZE, Instruction{});
+        }
+    }
+    uint64_t displayGeneration = state.disp.generation();
+    std::memcpy(&state, blobState, headerSize + header.memorySize);
+    state.disp.markReplaced(displayGeneration);
+    // Bytes past the variant's size stay zero
+    if (oldSize > header.memorySize) {
+        std::memset(state.mem.data() + header.memorySize, 0, oldSize - header.memorySize);
+    }
+    if (sameSize) {
+        state.mem.clearDirtyPages();
+        for (size_t page = 0; page < state.mem.pageCount(); ++page) {
+            if (written[page / 64] >> (page % 64) & 1) state.mem.markPageDirty(page);
+        }
+    } else {
+        state.mem.markAllDirty();
+    }
+
+    if (state.mode != oldMode || std::memcmp(&state.quirks, &oldQuirks, sizeof(Quirks)) != 0) {
+        partialInvalidate = false;
+    }
+    if (oldSize != header.memorySize) {
+        decodeCache.assign(state.mem.size(), Instruction{});
+        breakpoints.assign(state.mem.size(), false);
+        breakpointCount = 0;
+    } else if (!partialInvalidate) {
+        invalidateDecodeCache();
+    }
+    selectDecoder();
+    return true;
+}
+
+bool Chip8CPU::restore(const std::vector<uint8_t>& blob) {
+    return restore(blob.data(), blob.size());
+}
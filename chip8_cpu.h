@@ -11,6 +11,9 @@
 #include <cstdint>
 #include <array>
 #include <string>
+#include <vector>
+#include <functional>
+#include <type_traits>
 
 // Main CHIP-8 CPU class: emulates all instructions and manages state
 class Chip8CPU {
@@ -30,15 +33,72 @@ public:
         bool shiftUsesVy = false;       // 8XY6/8XYE: use Vy as source (true) or Vx (false)
         bool loadStoreIncrementI = true;  // FX55/FX65: increment I after operation (true = modern, false = original)
         bool jumpWithVx = false;        // BNNN: use VX instead of V0
+        bool displayWait = true;        // DXYN: draw at most once per frame, wait for the next one
     };
 
+    // Why a batched run (runCycles/runFrame) returned
+    enum class RunResult {
+        CycleBudget,   // Executed the requested number of instructions
+        FrameBoundary, // Reached the end of the 60 Hz frame (timers were ticked)
+        WaitingForKey, // FX0A is blocking on the keypad; the wait used up the rest of the batch
+        DisplayWait,   // DXYN is waiting for the next frame; the wait used up the rest of the batch
+        Idle,          // The guest spins in a loop only a timer tick can end; skipped whole iterations of it
+        Breakpoint,    // PC reached a breakpoint (not checked for the first instruction)
+        Fault          // The guest raised an error; PC points at the faulting instruction
+    };
+
+    // Guest errors; a faulted CPU stops executing until clearFault()
+    enum class Fault {
+        None,
+        StackOverflow,    // 2NNN with all 16 stack slots in use
+        StackUnderflow,   // 00EE with an empty stack
+        AddressOutOfRange // PC or an I-based access past the end of memory
+    };
+    using FaultCallback = std::function<void(Fault fault, uint16_t pc)>;
+
     explicit Chip8CPU(Variant variant = Variant::CHIP8);
 
+    // Returns the CPU to its just-constructed state for variant with the given quirks.
+    // Keeps the audio sink, volume/mute, fault callback and cache setting, and reuses
+    // the memory and decode cache allocations (they only grow when the variant needs more)
+    void reset(Variant variant, const Quirks& quirks);
+
+    // Quirk set the frontends use for each variant
+    static Quirks defaultQuirks(Variant variant);
+
+    // Quirks are compiled into the decoded handlers, so changing them flushes the decode cache
     void setQuirks(const Quirks& quirks);
     Quirks getQuirks() const;
 
     // Executes one instruction (fetch, decode, execute)
     void step();
+    // Executes instructions until the end of the current basic block (a jump, call,
+    // return, skip, draw or key wait), until maxInstructions ran or until the frame ends;
+    // returns the count
+    int runBlock(int maxInstructions);
+    // Executes up to maxCycles instructions without crossing the next frame boundary;
+    // the buzzer is updated once when the batch ends. Reaching the boundary ticks the timers,
+    // also when it is reached through step() or runBlock()
+    RunResult runCycles(int maxCycles);
+    // Executes the rest of the current frame
+    RunResult runFrame();
+
+    // Instructions per 60 Hz frame (defaults depend on the variant)
+    void setCyclesPerFrame(int cycles);
+    int getCyclesPerFrame() const;
+    // Counts include cycles fast-forwarded through waits and idle loops
+    uint64_t getCycleCount() const;
+    uint64_t getSkippedCycleCount() const;
+    uint64_t getFrameCount() const;
+
+    Fault getFault() const;
+    void clearFault();
+    // Called once when a fault is raised, with PC of the faulting instruction
+    void setFaultCallback(FaultCallback callback);
+
+    void addBreakpoint(uint16_t address);
+    void removeBreakpoint(uint16_t address);
+    void clearBreakpoints();
 
     // Access to subsystems for testing/debugging
     Chip8Memory& memory();
@@ -50,23 +110,173 @@ public:
 
     Variant getVariant() const;
 
-    // Save/load full emulator state to a file (for save states)
+    // Seeds the CXNN random generator; the same seed replays the same sequence
+    void seedRandom(uint64_t seed);
+    // Seeds the CXNN random generator from std::random_device (the default)
+    void seedRandomNondeterministic();
+    uint64_t getRandomSeed() const;
+
+    // Save states in the portable chunked format of chip8_savestate.h. Sound settings,
+    // breakpoints and callbacks are not included. Loading validates the whole file first
+    // and returns false, leaving the CPU untouched, if it is not a valid state
     bool saveState(const std::string& path) const;
+    void saveState(std::vector<uint8_t>& out) const;
+    // Maps the file and reads it in place
     bool loadState(const std::string& path);
+    bool loadState(const uint8_t* data, size_t size);
+
+    // In-memory snapshots: a raw copy of the machine state (memory only up to the variant's
+    // size). Sound settings, breakpoints and callbacks are not included. Blobs are only
+    // valid for the same build; use saveState for anything stored
+    size_t snapshotSize() const;
+    // Guest memory is the tail of a snapshot and starts at this offset
+    size_t snapshotMemoryOffset() const;
+    std::vector<uint8_t> snapshot() const;
+    // Writes into buffer; returns the bytes written, or 0 if capacity < snapshotSize()
+    size_t snapshot(uint8_t* buffer, size_t capacity) const;
+    // Returns false (and leaves the CPU untouched) if data is not a snapshot
+    bool restore(const uint8_t* data, size_t size);
+    bool restore(const std::vector<uint8_t>& blob);
+
+    // Drops all predecoded instructions (call after writing memory() directly)
+    void invalidateDecodeCache();
+    // Disabling the cache decodes every opcode straight from memory (reference interpreter,
+    // used to run a second CPU in lockstep for differential checks)
+    void setDecodeCacheEnabled(bool enabled);
+    bool getDecodeCacheEnabled() const;
 
 private:
-    Variant mode;
-    Quirks quirks;
-    Chip8Memory mem;
-    Chip8Registers regs;
-    Chip8Timers tmr;
-    Chip8Input inp;
-    Chip8Display disp;
+    // Predecoded instruction: handler plus operands extracted once per address
+    struct Instruction;
+    using Handler = void (Chip8CPU::*)(const Instruction&);
+    struct Instruction {
+        Handler handler = nullptr; // nullptr = not decoded yet
+        uint16_t opcode = 0;
+        uint16_t nnn = 0;
+        uint8_t x = 0;
+        uint8_t y = 0;
+        uint8_t n = 0;
+        uint8_t nn = 0;
+        bool endsBlock = false;    // Control flow may leave the straight-line sequence
+    };
+
+    // Complete machine state in one trivially copyable block with no heap storage.
+    // Memory is last and sized for XO-CHIP, so the variant's state is a prefix of it
+    struct State {
+        Variant mode = Variant::CHIP8;
+        Quirks quirks;
+        Fault fault = Fault::None;
+        int cyclesPerFrame = 12;
+        int frameCycles = 0;     // Instructions executed in the current frame
+        uint64_t cycleCount = 0; // Instructions executed since construction
+        uint64_t frameCount = 0; // Frames completed since construction
+        uint64_t skippedCycles = 0; // Part of cycleCount that was fast-forwarded
+        uint64_t lastDrawFrame = UINT64_MAX; // Frame of the last DXYN (display wait quirk)
+        uint64_t rngSeed = 0;  // Seed passed to seedRandom (saved with the state)
+        uint64_t rngState = 0; // xorshift64* state, never zero
+        bool keyWaitRelease = false; // FX0A: key latched, waiting for it to be released
+        int keyWaitKey = -1;         // FX0A: latched key while keyWaitRelease is set
+        Chip8Registers regs;
+        Chip8Timers tmr;
+        Chip8Input inp;
+        std::array<uint8_t, 16 * 16> audioBuffer{}; // XO-CHIP audio pattern buffer
+        Chip8Display disp;
+        Chip8Memory mem;
+    };
+    static_assert(std::is_trivially_copyable<State>::value, "State must be copyable with memcpy");
+
+    State state;
     Chip8Sound snd;
-    std::array<uint8_t, 16 * 16> audioBuffer{}; // XO-CHIP audio pattern buffer
+    std::vector<Instruction> decodeCache; // One entry per memory address, keyed by PC
+    Instruction uncached;                 // Scratch entry for PCs outside the cache
+    bool decodeCacheEnabled = true;
+    std::vector<bool> breakpoints; // One flag per memory address
+    int breakpointCount = 0;
+    FaultCallback faultCallback;
 
     // Fetches the next opcode (2 bytes) from memory at PC
     uint16_t fetchOpcode();
-    // Decodes and executes the given opcode
-    void executeOpcode(uint16_t opcode);
+    // Returns the decoded instruction at PC, decoding and caching it on a miss
+    const Instruction& fetchInstruction();
+    // Picks the handler for an opcode and extracts its operands
+    Instruction decode(uint16_t opcode) const;
+    // Decoder specialized for one variant; handlers are specialized on the active quirks
+    template <Variant V> Instruction decodeAs(uint16_t opcode) const;
+    using Decoder = Instruction (Chip8CPU::*)(uint16_t) const;
+    Decoder decoder = nullptr;
+    // Points decoder at the instantiation for the current variant
+    void selectDecoder();
+    // Starts/stops the buzzer to follow the sound timer
+    void updateSound();
+    // Ticks the timers and starts the next frame
+    void endFrame();
+    // Adds executed instructions to the counters, ending the frame when it is full
+    void accountCycles(int cycles);
+    // Instructions in the loop closed by the jump just executed at pc if it spins until the
+    // next timer tick (1 for a jump onto itself, 3 for a delay timer poll), else 0
+    int idleLoopLength(uint16_t pc, const Instruction& instr) const;
+    // True if one of the instructions starting at address has a breakpoint
+    bool hasBreakpoint(uint16_t address, int instructions) const;
+    // Next byte from the xorshift64* generator
+    uint8_t nextRandom();
+    // Bytes of state before the memory contents
+    size_t stateHeaderSize() const;
+    // Guest memory write that keeps the decode cache coherent
+    void writeMemory(uint16_t address, uint8_t value);
+    // Raises AddressOutOfRange unless span bytes starting at address are inside memory
+    bool checkRange(uint16_t address, int span);
+    // Leaves PC on the faulting instruction and notifies the fault callback
+    void reportFault(uint16_t pc);
+    // SCHIP VF after a draw: rows collided or clipped in high-res, 0/1 in low-res
+    uint8_t schipCollisionFlag(const Chip8Display::BlitResult& result) const;
+
+    // Instruction handlers
+    void opNop(const Instruction& in);
+    void opBadPC(const Instruction& in);
+    template <Variant V> void op00CN(const Instruction& in);
+    void op00DN(const Instruction& in);
+    void op00E0(const Instruction& in);
+    void op00EE(const Instruction& in);
+    void op00FB(const Instruction& in);
+    void op00FC(const Instruction& in);
+    void op00FE(const Instruction& in);
+    void op00FF(const Instruction& in);
+    void op1NNN(const Instruction& in);
+    void op2NNN(const Instruction& in);
+    void op3XNN(const Instruction& in);
+    void op4XNN(const Instruction& in);
+    void op5XY0(const Instruction& in);
+    void op5XY2(const Instruction& in);
+    void op5XY3(const Instruction& in);
+    void op6XNN(const Instruction& in);
+    void op7XNN(const Instruction& in);
+    void op8XY0(const Instruction& in);
+    template <bool ResetVF> void op8XY1(const Instruction& in);
+    template <bool ResetVF> void op8XY2(const Instruction& in);
+    template <bool ResetVF> void op8XY3(const Instruction& in);
+    void op8XY4(const Instruction& in);
+    void op8XY5(const Instruction& in);
+    template <bool ShiftUsesVy> void op8XY6(const Instruction& in);
+    void op8XY7(const Instruction& in);
+    template <bool ShiftUsesVy> void op8XYE(const Instruction& in);
+    void op9XY0(const Instruction& in);
+    void opANNN(const Instruction& in);
+    template <bool JumpWithVx> void opBNNN(const Instruction& in);
+    void opCXNN(const Instruction& in);
+    template <Variant V, bool DisplayWait> void opDXYN(const Instruction& in);
+    void opDXY0(const Instruction& in);
+    void opEX9E(const Instruction& in);
+    void opEXA1(const Instruction& in);
+    void opFX01(const Instruction& in);
+    void opFX07(const Instruction& in);
+    void opFX0A(const Instruction& in);
+    void opFX15(const Instruction& in);
+    void opFX18(const Instruction& in);
+    void opFX1E(const Instruction& in);
+    void opFX29(const Instruction& in);
+    void opFX33(const Instruction& in);
+    template <bool IncrementI> void opFX55(const Instruction& in);
+    template <bool IncrementI> void opFX65(const Instruction& in);
+    void opFX75(const Instruction& in);
+    void opFX85(const Instruction& in);
 };
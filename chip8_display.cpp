@@ -1,63 +1,148 @@
 #include "chip8_display.h"
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 
+namespace {
+    // Places a sprite row (Width bits, leftmost pixel first) at column x of a w pixel wide
+    // display row; Wrap brings the bits past the right edge back in on the left
+    template <Chip8Display::SpriteEdge Edge, int Width>
+    Chip8Display::PlaneRow spriteRowMask(uint32_t bits, int x, int w) {
+        constexpr bool wrap = (Edge == Chip8Display::SpriteEdge::Wrap);
+        uint64_t left = uint64_t(bits) << (64 - Width);
+        if (w == Chip8Display::LOWRES_WIDTH) {
+            return {(left >> x) | (wrap && x ? left << (64 - x) : 0), 0};
+        }
+        if (x < 64) return {left >> x, x ? left << (64 - x) : 0};
+        x -= 64;
+        return {wrap && x ? left << (64 - x) : 0, left >> x};
+    }
+}
+
 Chip8Display::Chip8Display() : mode(Mode::LowRes), colorMode(ColorMode::Mono), activePlanes(1) {
     clear();
 }
 
 void Chip8Display::clear() {
-    for (auto& row : fb) row.fill(0);
+    for (auto& p : planes) p.fill(PlaneRow{});
+    markAllDirty();
 }
 
 bool Chip8Display::drawSprite(uint8_t x, uint8_t y, const uint8_t* spriteData, uint8_t numRows, uint8_t planeMask) {
-    bool collision = false;
+    if (colorMode == ColorMode::XOCHIP_2BPP) {
+        return blit<SpriteEdge::Wrap, 8, XOCHIP_PLANES>(x, y, spriteData, numRows, planeMask).collision;
+    }
+    return blit<SpriteEdge::Wrap, 8, 1>(x, y, spriteData, numRows).collision;
+}
+
+template <Chip8Display::SpriteEdge Edge, int Width, int Planes>
+Chip8Display::BlitResult Chip8Display::blit(uint8_t x, uint8_t y, const uint8_t* data, int rows, uint8_t planeMask) {
+    static_assert(Width == 8 || Width == 16, "Sprites are 8 or 16 pixels wide");
+    static_assert(Planes == 1 || Planes == XOCHIP_PLANES, "Sprites draw on one or all planes");
+    BlitResult result;
+    uint64_t drawGeneration = generationCount + 1;
+    bool changed = false;
     int w = width();
     int h = height();
-    for (uint8_t row = 0; row < numRows; ++row) {
-        uint8_t spriteByte = spriteData[row];
-        for (uint8_t col = 0; col < 8; ++col) {
-            if ((spriteByte & (0x80 >> col)) != 0) {
-                int px = (x + col) % w;
-                int py = (y + row) % h;
-                if (colorMode == ColorMode::XOCHIP_2BPP) {
-                    for (int plane = 0; plane < XOCHIP_PLANES; ++plane) {
-                        if (planeMask & (1 << plane)) {
-                            uint8_t bit = (fb[py][px] >> plane) & 1;
-                            if (bit) collision = true;
-                            fb[py][px] ^= (1 << plane);
-                        }
-                    }
-                } else {
-                    if (fb[py][px]) collision = true;
-                    fb[py][px] ^= 1;
-                }
+    int startX = x & (w - 1);
+    int startY = y & (h - 1);
+    for (int row = 0; row < rows; ++row) {
+        int py = startY + row;
+        if (py >= h) {
+            if (Edge == SpriteEdge::Clip) {
+                result.clippedRows = rows - row;
+                break;
+            }
+            py -= h; // Sprites are at most 16 rows, less than any display height
+        }
+        uint32_t bits = (Width == 16) ? (data[row * 2] << 8 | data[row * 2 + 1]) : data[row];
+        if (!bits) continue;
+        PlaneRow mask = spriteRowMask<Edge, Width>(bits, startX, w);
+        if (!(mask[0] | mask[1])) continue;
+        rowGenerations[py] = drawGeneration;
+        changed = true;
+        uint64_t hits = 0;
+        if constexpr (Planes == 1) {
+            PlaneRow& target = planes[0][py];
+            const PlaneRow& other = planes[1][py];
+            hits = ((target[0] | other[0]) & mask[0]) | ((target[1] | other[1]) & mask[1]);
+            target[0] ^= mask[0];
+            target[1] ^= mask[1];
+        } else {
+            for (int plane = 0; plane < Planes; ++plane) {
+                if (!(planeMask & (1 << plane))) continue;
+                PlaneRow& target = planes[plane][py];
+                hits |= (target[0] & mask[0]) | (target[1] & mask[1]);
+                target[0] ^= mask[0];
+                target[1] ^= mask[1];
             }
         }
+        if (hits) {
+            result.collision = true;
+            ++result.collidedRows;
+        }
     }
-    return collision;
+    if (changed) generationCount = drawGeneration;
+    return result;
 }
 
+// The combinations the CPU and drawSprite use
+template Chip8Display::BlitResult Chip8Display::blit<Chip8Display::SpriteEdge::Clip, 8, 1>(uint8_t, uint8_t, const uint8_t*, int, uint8_t);
+template Chip8Display::BlitResult Chip8Display::blit<Chip8Display::SpriteEdge::Wrap, 8, 1>(uint8_t, uint8_t, const uint8_t*, int, uint8_t);
+template Chip8Display::BlitResult Chip8Display::blit<Chip8Display::SpriteEdge::Wrap, 8, 2>(uint8_t, uint8_t, const uint8_t*, int, uint8_t);
+template Chip8Display::BlitResult Chip8Display::blit<Chip8Display::SpriteEdge::Wrap, 16, 1>(uint8_t, uint8_t, const uint8_t*, int, uint8_t);
+
 uint8_t Chip8Display::getPixel(int x, int y) const {
     int w = width();
     int h = height();
     if (x < 0 || x >= w || y < 0 || y >= h) return 0;
-    return fb[y][x];
+    int word = x / 64;
+    int bit = 63 - x % 64;
+    return static_cast<uint8_t>(((planes[0][y][word] >> bit) & 1) | ((planes[1][y][word] >> bit) & 1) << 1);
 }
 
 void Chip8Display::setPixel(int x, int y, uint8_t value) {
     int w = width();
     int h = height();
     if (x < 0 || x >= w || y < 0 || y >= h) return;
-    fb[y][x] = value;
+    int word = x / 64;
+    uint64_t bit = uint64_t(1) << (63 - x % 64);
+    if (getPixel(x, y) == (value & 3)) return;
+    for (int plane = 0; plane < XOCHIP_PLANES; ++plane) {
+        if (value & (1 << plane)) planes[plane][y][word] |= bit;
+        else planes[plane][y][word] &= ~bit;
+    }
+    rowGenerations[y] = ++generationCount;
+}
+
+const Chip8Display::Plane& Chip8Display::plane(int index) const {
+    return planes[index & 1];
+}
+
+uint64_t Chip8Display::generation() const {
+    return generationCount;
+}
+
+uint64_t Chip8Display::dirtyRowsSince(uint64_t g) const {
+    uint64_t rows = 0;
+    for (int y = 0; y < HIRES_HEIGHT; ++y) {
+        if (rowGenerations[y] > g) rows |= uint64_t(1) << y;
+    }
+    return rows;
+}
+
+void Chip8Display::markAllDirty() {
+    markRowsDirty(HIRES_HEIGHT);
 }
 
-const std::array<std::array<uint8_t, Chip8Display::HIRES_WIDTH>, Chip8Display::HIRES_HEIGHT>& Chip8Display::framebuffer() const {
-    return fb;
+void Chip8Display::markReplaced(uint64_t previousGeneration) {
+    generationCount = std::max(generationCount, previousGeneration);
+    markAllDirty();
 }
 
-std::array<std::array<uint8_t, Chip8Display::HIRES_WIDTH>, Chip8Display::HIRES_HEIGHT>& Chip8Display::framebuffer() {
-    return fb;
+void Chip8Display::markRowsDirty(int count) {
+    ++generationCount;
+    std::fill(rowGenerations.begin(), rowGenerations.begin() + count, generationCount);
 }
 
 void Chip8Display::setMode(Mode m) {
@@ -94,147 +179,74 @@ uint8_t Chip8Display::getActivePlanes() const {
     return activePlanes;
 }
 
+uint8_t Chip8Display::scrollPlanes() const {
+    return (colorMode == ColorMode::XOCHIP_2BPP) ? activePlanes : 1;
+}
 
-bool Chip8Display::scrollUp(uint8_t lines) {
-    int w = width();
+void Chip8Display::shiftRows(int lines) {
     int h = height();
-    if (lines == 0) return true;
-    if (lines >= h) {
+    int span = lines < 0 ? -lines : lines;
+    if (span >= h) {
         clear();
-        return true;
+        return;
     }
-    if (colorMode == ColorMode::XOCHIP_2BPP) {
-        for (int plane = 0; plane < XOCHIP_PLANES; ++plane) {
-            if (!(activePlanes & (1 << plane))) continue;
-            for (int y = 0; y < h - lines; ++y) {
-                for (int x = 0; x < w; ++x) {
-                    uint8_t src = (fb[y + lines][x] >> plane) & 1;
-                    fb[y][x] = (fb[y][x] & ~(1 << plane)) | (src << plane);
-                }
-            }
-            for (int y = h - lines; y < h; ++y) {
-                for (int x = 0; x < w; ++x) {
-                    fb[y][x] &= ~(1 << plane);
-                }
-            }
-        }
-    } else {
-        for (int y = 0; y < h - lines; ++y) {
-            for (int x = 0; x < w; ++x) {
-                fb[y][x] = fb[y + lines][x] & 1;
-            }
-        }
-        for (int y = h - lines; y < h; ++y) {
-            for (int x = 0; x < w; ++x) {
-                fb[y][x] = 0;
-            }
+    size_t moved = (h - span) * sizeof(PlaneRow);
+    size_t cleared = span * sizeof(PlaneRow);
+    if (scrollPlanes() & 3) markRowsDirty(h);
+    for (int plane = 0; plane < XOCHIP_PLANES; ++plane) {
+        if (!(scrollPlanes() & (1 << plane))) continue;
+        PlaneRow* rows = planes[plane].data();
+        if (lines > 0) {
+            std::memmove(rows + span, rows, moved);
+            std::memset(rows, 0, cleared);
+        } else {
+            std::memmove(rows, rows + span, moved);
+            std::memset(rows + (h - span), 0, cleared);
         }
     }
-    return true;
 }
 
-bool Chip8Display::scrollDown(uint8_t lines) {
-    int w = width();
+void Chip8Display::shiftColumns(int pixels) {
     int h = height();
-    if (lines == 0) return true;
-    if (lines >= h) {
-        clear();
-        return true;
-    }
-    if (colorMode == ColorMode::XOCHIP_2BPP) {
-        for (int plane = 0; plane < XOCHIP_PLANES; ++plane) {
-            if (!(activePlanes & (1 << plane))) continue;
-            for (int y = h - 1; y >= lines; --y) {
-                for (int x = 0; x < w; ++x) {
-                    uint8_t src = (fb[y - lines][x] >> plane) & 1;
-                    fb[y][x] = (fb[y][x] & ~(1 << plane)) | (src << plane);
-                }
-            }
-            for (int y = 0; y < lines; ++y) {
-                for (int x = 0; x < w; ++x) {
-                    fb[y][x] &= ~(1 << plane);
-                }
-            }
-        }
-    } else {
-        for (int y = h - 1; y >= lines; --y) {
-            for (int x = 0; x < w; ++x) {
-                fb[y][x] = fb[y - lines][x] & 1;
+    int s = pixels < 0 ? -pixels : pixels;
+    // Low-res rows live in word 0; anything shifted into word 1 is off screen
+    uint64_t visible1 = (mode == Mode::HighRes) ? ~uint64_t(0) : 0;
+    if (scrollPlanes() & 3) markRowsDirty(h);
+    for (int plane = 0; plane < XOCHIP_PLANES; ++plane) {
+        if (!(scrollPlanes() & (1 << plane))) continue;
+        PlaneRow* rows = planes[plane].data();
+        if (pixels > 0) {
+            for (int y = 0; y < h; ++y) {
+                uint64_t w0 = rows[y][0], w1 = rows[y][1];
+                rows[y][0] = w0 >> s;
+                rows[y][1] = ((w1 >> s) | (w0 << (64 - s))) & visible1;
             }
-        }
-        for (int y = 0; y < lines; ++y) {
-            for (int x = 0; x < w; ++x) {
-                fb[y][x] = 0;
+        } else {
+            for (int y = 0; y < h; ++y) {
+                uint64_t w0 = rows[y][0], w1 = rows[y][1];
+                rows[y][0] = (w0 << s) | (w1 >> (64 - s));
+                rows[y][1] = w1 << s;
             }
         }
     }
+}
+
+bool Chip8Display::scrollUp(uint8_t lines) {
+    if (lines != 0) shiftRows(-lines);
+    return true;
+}
+
+bool Chip8Display::scrollDown(uint8_t lines) {
+    if (lines != 0) shiftRows(lines);
     return true;
 }
 
 bool Chip8Display::scrollLeft() {
-    int w = width();
-    int h = height();
-    int amount = 4;
-    if (amount >= w) {
-        clear();
-        return true;
-    }
-    if (colorMode == ColorMode::XOCHIP_2BPP) {
-        for (int plane = 0; plane < XOCHIP_PLANES; ++plane) {
-            if (!(activePlanes & (1 << plane))) continue;
-            for (int y = 0; y < h; ++y) {
-                for (int x = 0; x < w - amount; ++x) {
-                    uint8_t src = (fb[y][x + amount] >> plane) & 1;
-                    fb[y][x] = (fb[y][x] & ~(1 << plane)) | (src << plane);
-                }
-                for (int x = w - amount; x < w; ++x) {
-                    fb[y][x] &= ~(1 << plane);
-                }
-            }
-        }
-    } else {
-        for (int y = 0; y < h; ++y) {
-            for (int x = 0; x < w - amount; ++x) {
-                fb[y][x] = fb[y][x + amount] & 1;
-            }
-            for (int x = w - amount; x < w; ++x) {
-                fb[y][x] = 0;
-            }
-        }
-    }
+    shiftColumns(-4);
     return true;
 }
 
 bool Chip8Display::scrollRight() {
-    int w = width();
-    int h = height();
-    int amount = 4; 
-    if (amount >= w) {
-        clear();
-        return true;
-    }
-    if (colorMode == ColorMode::XOCHIP_2BPP) {
-        for (int plane = 0; plane < XOCHIP_PLANES; ++plane) {
-            if (!(activePlanes & (1 << plane))) continue;
-            for (int y = 0; y < h; ++y) {
-                for (int x = w - 1; x >= amount; --x) {
-                    uint8_t src = (fb[y][x - amount] >> plane) & 1;
-                    fb[y][x] = (fb[y][x] & ~(1 << plane)) | (src << plane);
-                }
-                for (int x = 0; x < amount; ++x) {
-                    fb[y][x] &= ~(1 << plane);
-                }
-            }
-        }
-    } else {
-        for (int y = 0; y < h; ++y) {
-            for (int x = w - 1; x >= amount; --x) {
-                fb[y][x] = fb[y][x - amount] & 1;
-            }
-            for (int x = 0; x < amount; ++x) {
-                fb[y][x] = 0;
-            }
-        }
-    }
+    shiftColumns(4);
     return true;
-} 
\ No newline at end of file
+}
\ No newline at end of file
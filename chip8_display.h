@@ -13,6 +13,11 @@ public:
     static constexpr int HIRES_HEIGHT = 64;
     static constexpr int XOCHIP_PLANES = 2; // 2bpp (2 planes)
 
+    // One bitplane row: pixel x is bit 63 - x % 64 of word x / 64 (leftmost pixel in the
+    // high bit). Low-res rows only use word 0
+    using PlaneRow = std::array<uint64_t, 2>;
+    using Plane = std::array<PlaneRow, HIRES_HEIGHT>;
+
     // Display mode: low-res (64x32) or high-res (128x64)
     enum class Mode {
         LowRes,
@@ -23,6 +28,16 @@ public:
         Mono,
         XOCHIP_2BPP
     };
+    // What happens to sprite pixels past the right or bottom edge
+    enum class SpriteEdge {
+        Clip, // Dropped (CHIP-8, SCHIP DXYN)
+        Wrap  // Drawn on the opposite side (XO-CHIP, DXY0)
+    };
+    struct BlitResult {
+        bool collision = false; // A drawn pixel was already set
+        int collidedRows = 0;   // Sprite rows with a collision
+        int clippedRows = 0;    // Sprite rows past the bottom edge (Clip only)
+    };
 
     Chip8Display();
 
@@ -30,13 +45,19 @@ public:
     void clear();
     // Draws a sprite at (x, y) with N bytes from spriteData, returns true if any pixel was unset (collision)
     bool drawSprite(uint8_t x, uint8_t y, const uint8_t* spriteData, uint8_t numRows, uint8_t planeMask = 1);
+    // Sprite blitter behind every draw. The start position wraps onto the screen; Edge decides
+    // what happens past the edges. Rows are Width / 8 bytes (8 or 16 pixels), leftmost pixel
+    // in the high bit, and each row is XORed in with one mask per plane. Planes = 1 draws on
+    // plane 0 and collides with any set pixel (mono); Planes = 2 draws the same rows on every
+    // plane in planeMask and collides with those planes only
+    template <SpriteEdge Edge, int Width, int Planes>
+    BlitResult blit(uint8_t x, uint8_t y, const uint8_t* data, int rows, uint8_t planeMask = 1);
     // Gets the pixel state (for mono: 0/1, for color: 0-3)
     uint8_t getPixel(int x, int y) const;
     // Sets a pixel state (for testing/debugging)
     void setPixel(int x, int y, uint8_t value);
-    // Access the framebuffer (for UI)
-    std::array<std::array<uint8_t, HIRES_WIDTH>, HIRES_HEIGHT>& framebuffer();
-    const std::array<std::array<uint8_t, HIRES_WIDTH>, HIRES_HEIGHT>& framebuffer() const;
+    // Access the packed bitplanes (plane 0 is the mono plane)
+    const Plane& plane(int index) const;
 
     // Set/get display mode (low-res or high-res)
     void setMode(Mode mode);
@@ -50,6 +71,15 @@ public:
     void setActivePlanes(uint8_t mask); // For XO-CHIP plane selection
     uint8_t getActivePlanes() const;
 
+    // Change tracking for presenters: generation() grows with every change to the image and
+    // each row keeps the generation it last changed in. After presenting generation g, the
+    // rows to upload again are dirtyRowsSince(g) (bit y = row y). Copies keep their stamps,
+    // so a presenter can switch between displays (run-ahead) by comparing generations
+    uint64_t generation() const;
+    uint64_t dirtyRowsSince(uint64_t generation) const;
+    // Counts the whole image as changed (after it was replaced wholesale)
+    void markAllDirty();
+
     // Scroll up by N lines (0 = no scroll, clears if >= height)
     bool scrollUp(uint8_t lines);
     // Scroll down by N lines (0 = no scroll, clears if >= height)
@@ -58,10 +88,24 @@ public:
     bool scrollLeft();
     bool scrollRight();
 
-public:
-    std::array<std::array<uint8_t, HIRES_WIDTH>, HIRES_HEIGHT> fb; // 0-3 for 2bpp, 0/1 for mono
-    friend class Chip8CPU;
 private:
+    friend class Chip8CPU;
+    // Bitmask of the planes scrolls move: the active planes in 2bpp, plane 0 in mono
+    uint8_t scrollPlanes() const;
+    // Scroll engine for the scrollPlanes() inside the visible area. Rows move with one
+    // memmove per plane (lines > 0 is down; a full height or more clears the display).
+    // Columns shift across each row's word pair (pixels > 0 is right, 1 to 63 pixels)
+    void shiftRows(int lines);
+    void shiftColumns(int pixels);
+    // Stamps rows [0, count) with a new generation
+    void markRowsDirty(int count);
+    // After the whole display was overwritten (reset, restore): marks every row dirty with a
+    // generation past both the overwritten one and the new one, so presenters never see reuse
+    void markReplaced(uint64_t previousGeneration);
+
+    std::array<Plane, XOCHIP_PLANES> planes; // 2 KB for both planes at high-res
+    uint64_t generationCount = 0;
+    std::array<uint64_t, HIRES_HEIGHT> rowGenerations{}; // Generation each row last changed in
     Mode mode;
     ColorMode colorMode;
     uint8_t activePlanes; // Bitmask for XO-CHIP plane selection
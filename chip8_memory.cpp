@@ -24,39 +24,74 @@ static const uint8_t chip8_fontset[80] = {
     0xF0, 0x80, 0xF0, 0x80, 0x80  // F
 };
 
-Chip8Memory::Chip8Memory(size_t size) : memory(size, 0) {
+Chip8Memory::Chip8Memory(size_t size)
+    : length(static_cast<uint32_t>(std::min(size, XOCHIP_MEMORY_SIZE))), mask(static_cast<uint16_t>(length - 1)) {
     loadFontset();
+    markAllDirty();
 }
 
-uint8_t Chip8Memory::read(uint16_t address) const {
-    if (address >= memory.size()) {
-        throw std::out_of_range("Memory read out of range");
-    }
-    return memory[address];
-}
-
-void Chip8Memory::write(uint16_t address, uint8_t value) {
-    if (address >= memory.size()) {
-        throw std::out_of_range("Memory write out of range");
-    }
-    memory[address] = value;
+void Chip8Memory::reset(size_t size) {
+    memory.fill(0);
+    length = static_cast<uint32_t>(std::min(size, XOCHIP_MEMORY_SIZE));
+    mask = static_cast<uint16_t>(length - 1);
+    dirty.fill(0);
+    loadFontset();
+    markAllDirty();
 }
 
 void Chip8Memory::loadROM(const std::vector<uint8_t>& rom) {
-    if (rom.size() + PROGRAM_START > memory.size()) {
+    if (rom.size() + PROGRAM_START > length) {
         throw std::runtime_error("ROM too large to fit in memory");
     }
     std::copy(rom.begin(), rom.end(), memory.begin() + PROGRAM_START);
+    for (size_t page = PROGRAM_START / PAGE_SIZE; page * PAGE_SIZE < PROGRAM_START + rom.size(); ++page) {
+        dirty[page / 64] |= uint64_t(1) << (page % 64);
+    }
 }
 
 void Chip8Memory::loadFontset() {
-    if (FONTSET_START + FONTSET_SIZE <= memory.size()) {
+    if (FONTSET_START + FONTSET_SIZE <= length) {
         std::copy(chip8_fontset, chip8_fontset + FONTSET_SIZE, memory.begin() + FONTSET_START);
     }
 }
 
 size_t Chip8Memory::size() const {
-    return memory.size();
+    return length;
+}
+
+uint16_t Chip8Memory::addressMask() const {
+    return mask;
+}
+
+size_t Chip8Memory::pageCount() const {
+    return length / PAGE_SIZE;
+}
+
+bool Chip8Memory::isPageDirty(size_t page) const {
+    if (page >= pageCount()) return false;
+    return (dirty[page / 64] >> (page % 64)) & 1;
+}
+
+size_t Chip8Memory::dirtyPageCount() const {
+    size_t count = 0;
+    for (size_t page = 0; page < pageCount(); ++page) {
+        if (isPageDirty(page)) ++count;
+    }
+    return count;
+}
+
+void Chip8Memory::clearDirtyPages() {
+    dirty.fill(0);
+}
+
+void Chip8Memory::markPageDirty(size_t page) {
+    if (page < pageCount()) dirty[page / 64] |= uint64_t(1) << (page % 64);
+}
+
+void Chip8Memory::markAllDirty() {
+    for (size_t page = 0; page < pageCount(); ++page) {
+        dirty[page / 64] |= uint64_t(1) << (page % 64);
+    }
 }
 
 uint8_t* Chip8Memory::data() {
@@ -5,7 +5,9 @@
 #define CHIP8_MEMORY_H
 
 #include <vector>
+#include <array>
 #include <cstdint>
+#include <cstddef>
 
 class Chip8Memory {
 public:
@@ -15,25 +17,50 @@ public:
     static constexpr uint16_t PROGRAM_START = 0x200;
     static constexpr size_t FONTSET_START = 0x50;
     static constexpr size_t FONTSET_SIZE = 80; // 16 characters * 5 bytes each
+    static constexpr size_t PAGE_SIZE = 256;   // Granularity of dirty tracking
 
+    // size must be a power of two no larger than XOCHIP_MEMORY_SIZE
     explicit Chip8Memory(size_t size = CHIP8_MEMORY_SIZE);
 
-    // Read/write memory at address
-    uint8_t read(uint16_t address) const;
-    void write(uint16_t address, uint8_t value);
+    // Zeroes memory, switches to the given size and reloads the fontset
+    void reset(size_t size);
+
+    // Read/write memory at address (wraps around the end of memory, never throws)
+    uint8_t read(uint16_t address) const { return memory[address & mask]; }
+    void write(uint16_t address, uint8_t value) {
+        address &= mask;
+        memory[address] = value;
+        size_t page = address / PAGE_SIZE;
+        dirty[page / 64] |= uint64_t(1) << (page % 64);
+    }
     // Load a ROM into memory (starting at PROGRAM_START)
     void loadROM(const std::vector<uint8_t>& rom);
     // Load the CHIP-8 fontset into memory
     void loadFontset();
 
     size_t size() const;
+    uint16_t addressMask() const;
+
+    // Pages written since the last clearDirtyPages() (write() and loadROM() mark pages;
+    // writes through data() are not tracked). Chip8Rewind clears them at every keyframe and
+    // skips clean pages when it captures a frame; Chip8CPU::restore marks the pages it changes
+    size_t pageCount() const;
+    bool isPageDirty(size_t page) const;
+    size_t dirtyPageCount() const;
+    void clearDirtyPages();
+    void markPageDirty(size_t page);
+    void markAllDirty();
 
     // Direct access to memory array
     uint8_t* data();
     const uint8_t* data() const;
 
 private:
-    std::vector<uint8_t> memory;
+    uint32_t length;   // Addressable size (power of two, at most XOCHIP_MEMORY_SIZE)
+    uint16_t mask;
+    std::array<uint64_t, XOCHIP_MEMORY_SIZE / PAGE_SIZE / 64> dirty{}; // One bit per page
+    // Fixed capacity so memory holds no heap storage; bytes past length stay zero
+    std::array<uint8_t, XOCHIP_MEMORY_SIZE> memory{};
 };
 
 #endif
\ No newline at end of file
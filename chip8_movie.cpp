@@ -0,0 +1,187 @@
+// CHIP8CHAPA - Input movie
+// Records keypad changes against the instruction count and replays them exactly
+
+#include "chip8_movie.h"
+#include "chip8_savestate.h"
+#include <algorithm>
+#include <fstream>
+
+namespace {
+    constexpr uint32_t MOVIE_MAGIC = 0x564D3843; // "C8MV"
+    constexpr uint32_t MOVIE_VERSION = 2; // 2: start state in the save-state format
+    constexpr uint64_t MIN_EVENT_BYTES = 2; // One-byte cycle delta and the key byte
+
+    // Fixed-width fields are little-endian regardless of the host
+    void writeLE(std::ostream& out, uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; ++i) out.put(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+
+    bool readLE(std::istream& in, uint64_t& value, int bytes) {
+        value = 0;
+        for (int i = 0; i < bytes; ++i) {
+            int c = in.get();
+            if (c == EOF) return false;
+            value |= static_cast<uint64_t>(c & 0xFF) << (8 * i);
+        }
+        return true;
+    }
+
+    void writeVarint(std::ostream& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.put(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        out.put(static_cast<char>(value));
+    }
+
+    // Bytes between the read position and the end of the stream
+    uint64_t bytesLeft(std::istream& in) {
+        std::streampos here = in.tellg();
+        in.seekg(0, std::ios::end);
+        std::streampos end = in.tellg();
+        in.seekg(here);
+        if (here < 0 || end < here) return 0;
+        return static_cast<uint64_t>(end - here);
+    }
+
+    bool readVarint(std::istream& in, uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            int c = in.get();
+            if (c == EOF) return false;
+            value |= static_cast<uint64_t>(c & 0x7F) << shift;
+            if (!(c & 0x80)) return true;
+        }
+        return false;
+    }
+}
+
+void Chip8Movie::startRecording(const Chip8CPU& cpu) {
+    cpu.saveState(startState);
+    seed = cpu.getRandomSeed();
+    startCycle = cpu.getCycleCount();
+    endCycle = startCycle;
+    events.clear();
+    cursor = 0;
+    playing = false;
+    recording = true;
+}
+
+void Chip8Movie::stopRecording(const Chip8CPU& cpu) {
+    if (!recording) return;
+    endCycle = cpu.getCycleCount();
+    recording = false;
+}
+
+bool Chip8Movie::isRecording() const { return recording; }
+
+void Chip8Movie::setKey(Chip8CPU& cpu, uint8_t key, bool pressed) {
+    if (key >= Chip8Input::NUM_KEYS) return;
+    if (recording && cpu.input().isPressed(key) != pressed) {
+        events.push_back({cpu.getCycleCount(), key, pressed});
+    }
+    cpu.input().setKey(key, pressed);
+}
+
+bool Chip8Movie::startPlayback(Chip8CPU& cpu) {
+    if (recording || startState.empty() || !cpu.loadState(startState.data(), startState.size())) return false;
+    cursor = 0;
+    playing = true;
+    return true;
+}
+
+Chip8CPU::RunResult Chip8Movie::runFrame(Chip8CPU& cpu) {
+    if (!playing) return cpu.runFrame();
+    Chip8CPU::RunResult result;
+    uint64_t frame = cpu.getFrameCount();
+    do {
+        uint64_t now = cpu.getCycleCount();
+        while (cursor < events.size() && events[cursor].cycle <= now) {
+            cpu.input().setKey(events[cursor].key, events[cursor].pressed);
+            ++cursor;
+        }
+        // Stop the batch at the next event so it lands on its recorded instruction
+        int budget = cpu.getCyclesPerFrame();
+        if (cursor < events.size()) {
+            budget = static_cast<int>(std::min<uint64_t>(budget, events[cursor].cycle - now));
+        }
+        result = cpu.runCycles(budget);
+    } while (cpu.getFrameCount() == frame && result != Chip8CPU::RunResult::Fault &&
+             result != Chip8CPU::RunResult::Breakpoint);
+    return result;
+}
+
+bool Chip8Movie::isPlaying() const { return playing; }
+
+bool Chip8Movie::isFinished(const Chip8CPU& cpu) const {
+    return cpu.getCycleCount() >= endCycle;
+}
+
+void Chip8Movie::stop() {
+    recording = false;
+    playing = false;
+}
+
+bool Chip8Movie::save(const std::string& path) const {
+    if (startState.empty()) return false;
+    std::ofstream out(path, std::ios::binary);
+    if (!out) return false;
+    writeLE(out, MOVIE_MAGIC, 4);
+    writeLE(out, MOVIE_VERSION, 4);
+    writeLE(out, seed, 8);
+    writeLE(out, startCycle, 8);
+    writeLE(out, endCycle, 8);
+    writeLE(out, startState.size(), 4);
+    out.write(reinterpret_cast<const char*>(startState.data()), startState.size());
+    writeLE(out, events.size(), 4);
+    uint64_t last = startCycle;
+    for (const auto& event : events) {
+        writeVarint(out, event.cycle - last);
+        out.put(static_cast<char>(event.key | (event.pressed ? 0x80 : 0)));
+        last = event.cycle;
+    }
+    return !!out;
+}
+
+bool Chip8Movie::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    uint64_t magic = 0, version = 0, newSeed = 0, newStart = 0, newEnd = 0, stateSize = 0, count = 0;
+    if (!readLE(in, magic, 4) || magic != MOVIE_MAGIC) return false;
+    if (!readLE(in, version, 4) || version != MOVIE_VERSION) return false;
+    if (!readLE(in, newSeed, 8) || !readLE(in, newStart, 8) || !readLE(in, newEnd, 8)) return false;
+    if (!readLE(in, stateSize, 4)) return false;
+    // Sizes are checked against the file before anything is allocated for them
+    uint64_t left = bytesLeft(in);
+    if (stateSize > Chip8SaveState::MAX_FILE_SIZE || stateSize + 4 > left) return false;
+    std::vector<uint8_t> newState(stateSize);
+    in.read(reinterpret_cast<char*>(newState.data()), stateSize);
+    if (!in || !readLE(in, count, 4)) return false;
+    if (count * MIN_EVENT_BYTES > left - stateSize - 4) return false;
+    std::vector<Event> newEvents;
+    newEvents.reserve(count);
+    uint64_t cycle = newStart;
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t delta = 0;
+        if (!readVarint(in, delta)) return false;
+        int packed = in.get();
+        if (packed == EOF) return false;
+        cycle += delta;
+        newEvents.push_back({cycle, static_cast<uint8_t>(packed & 0x0F), (packed & 0x80) != 0});
+    }
+
+    startState = std::move(newState);
+    seed = newSeed;
+    startCycle = newStart;
+    endCycle = newEnd;
+    events = std::move(newEvents);
+    cursor = 0;
+    recording = false;
+    playing = false;
+    return true;
+}
+
+uint64_t Chip8Movie::getSeed() const { return seed; }
+uint64_t Chip8Movie::getStartCycle() const { return startCycle; }
+uint64_t Chip8Movie::getEndCycle() const { return endCycle; }
+const std::vector<Chip8Movie::Event>& Chip8Movie::getEvents() const { return events; }
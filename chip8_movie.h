@@ -0,0 +1,66 @@
+// CHIP8CHAPA - Input movie header
+// Declares recording and bit-exact replay of keypad input stamped with the instruction count
+
+#ifndef CHIP8_MOVIE_H
+#define CHIP8_MOVIE_H
+
+#include "chip8_cpu.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A movie is the CPU state at the start of recording plus every keypad change, stamped with
+// getCycleCount() at the moment it happened. Replaying applies each change before the
+// instruction at the same count, so the run is reproduced exactly at any speed.
+// Record while running whole frames (runFrame), as the frontends do: waits are fast-forwarded
+// to the end of a batch, so keys must change on the batch boundaries that replay uses.
+class Chip8Movie {
+public:
+    struct Event {
+        uint64_t cycle; // Instruction count at which the key changed
+        uint8_t key;
+        bool pressed;
+    };
+
+    // Captures the start state (including the PRNG seed) and clears the event list
+    void startRecording(const Chip8CPU& cpu);
+    void stopRecording(const Chip8CPU& cpu);
+    bool isRecording() const;
+
+    // Applies a key change to cpu and records it when recording; repeats of the
+    // current key state are not recorded
+    void setKey(Chip8CPU& cpu, uint8_t key, bool pressed);
+
+    // Restores the start state and rewinds to the first event; false if nothing was recorded
+    bool startPlayback(Chip8CPU& cpu);
+    // Runs the rest of the current frame. While playing, batches stop at every event so keys
+    // change at their recorded instruction; otherwise this is cpu.runFrame()
+    Chip8CPU::RunResult runFrame(Chip8CPU& cpu);
+    bool isPlaying() const;
+    // True once playback reached the instruction count where recording stopped
+    bool isFinished(const Chip8CPU& cpu) const;
+    void stop();
+
+    // Movie files: magic, version, seed, cycle range, start state, then the events with
+    // delta-encoded cycles. The start state is a Chip8CPU save state, so movies are portable
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+    uint64_t getSeed() const;
+    uint64_t getStartCycle() const;
+    uint64_t getEndCycle() const;
+    const std::vector<Event>& getEvents() const;
+
+private:
+    std::vector<uint8_t> startState;
+    uint64_t seed = 0;
+    uint64_t startCycle = 0;
+    uint64_t endCycle = 0;
+    std::vector<Event> events;
+    size_t cursor = 0; // Next event to apply during playback
+    bool recording = false;
+    bool playing = false;
+};
+
+#endif
@@ -6,14 +6,15 @@
 
 #include <array>
 #include <cstdint>
+#include <cstddef>
 
 class Chip8Registers {
 public:
     Chip8Registers();
 
-    // Access general purpose registers V0-VF
-    uint8_t& V(size_t idx);
-    const uint8_t& V(size_t idx) const;
+    // Access general purpose registers V0-VF (index is taken modulo 16)
+    uint8_t& V(size_t idx) { return v[idx & 0xF]; }
+    const uint8_t& V(size_t idx) const { return v[idx & 0xF]; }
 
     // Access index register
     uint16_t& I();
@@ -27,9 +28,9 @@ public:
     uint8_t& SP();
     const uint8_t& SP() const;
 
-    // Stack operations
-    void push(uint16_t value);
-    uint16_t pop();
+    // Stack operations; return false on overflow/underflow and leave the stack unchanged
+    bool push(uint16_t value);
+    bool pop(uint16_t& value);
 
     // Direct access to stack array
     std::array<uint16_t, 16>& getStack();
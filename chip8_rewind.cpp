@@ -0,0 +1,175 @@
+// CHIP8CHAPA - Rewind buffer
+// Stores per-frame snapshots as XOR/RLE deltas against periodic keyframes
+
+#include "chip8_rewind.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    void putVarint(std::vector<uint8_t>& out, size_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    size_t getVarint(const uint8_t*& in) {
+        size_t value = 0;
+        int shift = 0;
+        uint8_t byte;
+        do {
+            byte = *in++;
+            value |= static_cast<size_t>(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        return value;
+    }
+
+    // Encodes data XOR reference (reference may be null) as pairs of
+    // <zero run length><literal length><literal bytes>. With memory set, the pages of it that
+    // are clean are known to match reference (memory starts at memoryOffset in data)
+    void encode(const uint8_t* data, const uint8_t* reference, size_t size, std::vector<uint8_t>& out,
+                const Chip8Memory* memory = nullptr, size_t memoryOffset = 0) {
+        auto at = [&](size_t i) -> uint8_t { return reference ? data[i] ^ reference[i] : data[i]; };
+        auto wordAt = [&](size_t i) -> uint64_t {
+            uint64_t a = 0, b = 0;
+            std::memcpy(&a, data + i, 8);
+            if (reference) std::memcpy(&b, reference + i, 8);
+            return a ^ b;
+        };
+        // End of the run of clean pages holding byte i, or i if it is not on one
+        auto cleanEnd = [&](size_t i) -> size_t {
+            if (!memory || i < memoryOffset) return i;
+            size_t page = (i - memoryOffset) / Chip8Memory::PAGE_SIZE;
+            if (memory->isPageDirty(page)) return i;
+            while (page < memory->pageCount() && !memory->isPageDirty(page)) ++page;
+            return std::min(size, memoryOffset + page * Chip8Memory::PAGE_SIZE);
+        };
+        out.clear();
+        size_t i = 0;
+        while (i < size) {
+            // Most of a delta is zero, so skip it a word at a time, or a page run at a time
+            size_t zeros = i;
+            for (;;) {
+                size_t clean = cleanEnd(zeros);
+                if (clean > zeros) zeros = clean;
+                else if (zeros + 8 <= size && wordAt(zeros) == 0) zeros += 8;
+                else break;
+            }
+            while (zeros < size && at(zeros) == 0) ++zeros;
+            putVarint(out, zeros - i);
+            i = zeros;
+            // A literal ends at the next pair of zero bytes
+            size_t end = i;
+            while (end < size && !(at(end) == 0 && (end + 1 == size || at(end + 1) == 0))) ++end;
+            putVarint(out, end - i);
+            for (; i < end; ++i) out.push_back(at(i));
+        }
+    }
+
+    // Reverses encode into out (size bytes); reference must match the one used to encode
+    void decode(const std::vector<uint8_t>& encoded, const uint8_t* reference, uint8_t* out, size_t size) {
+        const uint8_t* in = encoded.data();
+        const uint8_t* inEnd = in + encoded.size();
+        size_t i = 0;
+        while (in < inEnd && i < size) {
+            size_t zeros = std::min(getVarint(in), size - i);
+            if (reference) std::memcpy(out + i, reference + i, zeros);
+            else std::memset(out + i, 0, zeros);
+            i += zeros;
+            size_t literal = std::min(getVarint(in), size - i);
+            for (size_t end = i + literal; i < end; ++i) {
+                uint8_t byte = *in++;
+                out[i] = reference ? byte ^ reference[i] : byte;
+            }
+        }
+    }
+}
+
+Chip8Rewind::Chip8Rewind(size_t capacity, size_t keyframeInterval)
+    : capacity(std::max<size_t>(capacity, 1)), keyframeInterval(std::max<size_t>(keyframeInterval, 1)) {}
+
+void Chip8Rewind::capture(Chip8CPU& cpu) {
+    current.resize(cpu.snapshotSize());
+    cpu.snapshot(current.data(), current.size());
+
+    bool newKeyframe = groups.empty() || groups.back().deltas.size() + 1 >= keyframeInterval ||
+                       keyframeRaw.size() != current.size();
+    if (newKeyframe) {
+        groups.emplace_back();
+        encode(current.data(), nullptr, current.size(), groups.back().keyframe);
+        bytes += groups.back().keyframe.size();
+        keyframeRaw = current;
+        cpu.memory().clearDirtyPages();
+    } else {
+        std::vector<uint8_t> delta;
+        encode(current.data(), keyframeRaw.data(), current.size(), delta, &cpu.memory(), cpu.snapshotMemoryOffset());
+        bytes += delta.size();
+        groups.back().deltas.push_back(std::move(delta));
+    }
+    ++frames;
+
+    // Whole groups are dropped so every remaining delta keeps its keyframe
+    while (frames > capacity && groups.size() > 1) {
+        const Group& oldest = groups.front();
+        frames -= 1 + oldest.deltas.size();
+        bytes -= oldest.keyframe.size();
+        for (const auto& delta : oldest.deltas) bytes -= delta.size();
+        groups.pop_front();
+    }
+}
+
+bool Chip8Rewind::stepBack(Chip8CPU& cpu) {
+    if (frames < 2) return false;
+    Group& newest = groups.back();
+    bool keyframeDropped = newest.deltas.empty();
+    if (!keyframeDropped) {
+        bytes -= newest.deltas.back().size();
+        newest.deltas.pop_back();
+    } else {
+        bytes -= newest.keyframe.size();
+        groups.pop_back();
+        loadNewestKeyframe();
+    }
+    --frames;
+
+    const Group& target = groups.back();
+    bool restored;
+    if (target.deltas.empty()) {
+        restored = cpu.restore(keyframeRaw);
+    } else {
+        current.resize(keyframeRaw.size());
+        decode(target.deltas.back(), keyframeRaw.data(), current.data(), current.size());
+        restored = cpu.restore(current);
+    }
+    // Clean pages matched the dropped keyframe, not the one now in use
+    if (restored && keyframeDropped) cpu.memory().markAllDirty();
+    return restored;
+}
+
+void Chip8Rewind::loadNewestKeyframe() {
+    const std::vector<uint8_t>& encoded = groups.back().keyframe;
+    // The decoded size is implied by the encoding; sum the runs to find it
+    size_t size = 0;
+    const uint8_t* in = encoded.data();
+    const uint8_t* inEnd = in + encoded.size();
+    while (in < inEnd) {
+        size += getVarint(in);
+        size_t literal = getVarint(in);
+        size += literal;
+        in += literal;
+    }
+    keyframeRaw.resize(size);
+    decode(encoded, nullptr, keyframeRaw.data(), size);
+}
+
+void Chip8Rewind::clear() {
+    groups.clear();
+    frames = 0;
+    bytes = 0;
+    keyframeRaw.clear();
+}
+
+size_t Chip8Rewind::frameCount() const { return frames; }
+size_t Chip8Rewind::memoryUsage() const { return bytes; }
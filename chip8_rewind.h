@@ -0,0 +1,52 @@
+// CHIP8CHAPA - Rewind buffer header
+// Declares a ring of per-frame CPU snapshots stored as compressed deltas against keyframes
+
+#ifndef CHIP8_REWIND_H
+#define CHIP8_REWIND_H
+
+#include "chip8_cpu.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Each captured frame is a Chip8CPU snapshot. Every keyframeInterval frames a keyframe is
+// stored run-length encoded; the frames in between store the RLE of their XOR against that
+// keyframe, so unchanged memory costs almost nothing. The oldest keyframe and its deltas are
+// dropped together once more than capacity frames are held.
+// Capturing a keyframe clears the CPU's dirty-page bits, so the pages still clean at a later
+// capture match the keyframe and are encoded as zero runs without being read.
+class Chip8Rewind {
+public:
+    explicit Chip8Rewind(size_t capacity = 60 * 60, size_t keyframeInterval = 60);
+
+    // Records the current state (call once per emulated frame); clears the dirty-page bits
+    // of cpu's memory at keyframes, so pass the same CPU every time until clear()
+    void capture(Chip8CPU& cpu);
+    // Drops the newest frame and restores the one before it; false when nothing is left
+    bool stepBack(Chip8CPU& cpu);
+    void clear();
+
+    size_t frameCount() const;
+    // Bytes held by the encoded frames
+    size_t memoryUsage() const;
+
+private:
+    struct Group {
+        std::vector<uint8_t> keyframe;            // RLE of the keyframe snapshot
+        std::vector<std::vector<uint8_t>> deltas; // RLE of (snapshot XOR keyframe)
+    };
+
+    // Decodes the newest group's keyframe into keyframeRaw
+    void loadNewestKeyframe();
+
+    size_t capacity;
+    size_t keyframeInterval;
+    std::deque<Group> groups;
+    size_t frames = 0;
+    size_t bytes = 0;
+    std::vector<uint8_t> keyframeRaw; // Decoded keyframe of groups.back()
+    std::vector<uint8_t> current;     // Scratch snapshot
+};
+
+#endif
@@ -0,0 +1,189 @@
+// CHIP8CHAPA - Save-state file format
+// Writes and validates the chunked save-state container and maps files for reading
+
+#include "chip8_savestate.h"
+#include <array>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Chip8SaveState {
+
+namespace {
+    constexpr size_t FILE_HEADER_SIZE = 12;  // Magic, version, chunk count
+    constexpr size_t CHUNK_HEADER_SIZE = 12; // Id, size, CRC
+
+    uint32_t readLE32(const uint8_t* p) {
+        return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+    }
+
+    void writeLE32(uint8_t* p, uint32_t value) {
+        for (int i = 0; i < 4; ++i) p[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+uint32_t crc32(const uint8_t* data, size_t size) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+Writer::Writer() {
+    buffer.reserve(FILE_HEADER_SIZE);
+    u32(MAGIC);
+    u32(VERSION);
+    u32(0); // Chunk count, updated by endChunk
+}
+
+void Writer::beginChunk(uint32_t id) {
+    chunkStart = buffer.size();
+    u32(id);
+    u32(0);
+    u32(0);
+}
+
+void Writer::endChunk() {
+    size_t payload = chunkStart + CHUNK_HEADER_SIZE;
+    size_t size = buffer.size() - payload;
+    writeLE32(buffer.data() + chunkStart + 4, static_cast<uint32_t>(size));
+    writeLE32(buffer.data() + chunkStart + 8, crc32(buffer.data() + payload, size));
+    writeLE32(buffer.data() + 8, ++chunkCount);
+}
+
+void Writer::u8(uint8_t value) { buffer.push_back(value); }
+void Writer::u16(uint16_t value) {
+    buffer.push_back(static_cast<uint8_t>(value));
+    buffer.push_back(static_cast<uint8_t>(value >> 8));
+}
+void Writer::u32(uint32_t value) {
+    uint8_t le[4];
+    writeLE32(le, value);
+    buffer.insert(buffer.end(), le, le + 4);
+}
+void Writer::u64(uint64_t value) {
+    u32(static_cast<uint32_t>(value));
+    u32(static_cast<uint32_t>(value >> 32));
+}
+void Writer::bytes(const uint8_t* data, size_t size) { buffer.insert(buffer.end(), data, data + size); }
+
+const std::vector<uint8_t>& Writer::data() const { return buffer; }
+
+ChunkReader::ChunkReader(const uint8_t* data, size_t size) : data(data), length(size) {}
+
+const uint8_t* ChunkReader::bytes(size_t size) {
+    if (!valid || length - offset < size) {
+        valid = false;
+        return nullptr;
+    }
+    const uint8_t* p = data + offset;
+    offset += size;
+    return p;
+}
+
+uint8_t ChunkReader::u8() {
+    const uint8_t* p = bytes(1);
+    return p ? p[0] : 0;
+}
+uint16_t ChunkReader::u16() {
+    const uint8_t* p = bytes(2);
+    return p ? static_cast<uint16_t>(p[0] | p[1] << 8) : 0;
+}
+uint32_t ChunkReader::u32() {
+    const uint8_t* p = bytes(4);
+    return p ? readLE32(p) : 0;
+}
+uint64_t ChunkReader::u64() {
+    uint64_t low = u32();
+    return low | uint64_t(u32()) << 32;
+}
+
+size_t ChunkReader::size() const { return length; }
+bool ChunkReader::ok() const { return valid; }
+
+bool Reader::open(const uint8_t* data, size_t size) {
+    chunks.clear();
+    if (!data || size < FILE_HEADER_SIZE || size > MAX_FILE_SIZE) return false;
+    if (readLE32(data) != MAGIC || readLE32(data + 4) != VERSION) return false;
+    uint32_t count = readLE32(data + 8);
+    size_t offset = FILE_HEADER_SIZE;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (size - offset < CHUNK_HEADER_SIZE) return false;
+        const uint8_t* header = data + offset;
+        size_t payloadSize = readLE32(header + 4);
+        offset += CHUNK_HEADER_SIZE;
+        if (size - offset < payloadSize) return false;
+        if (crc32(data + offset, payloadSize) != readLE32(header + 8)) return false;
+        chunks.push_back({readLE32(header), data + offset, payloadSize});
+        offset += payloadSize;
+    }
+    return offset == size;
+}
+
+bool Reader::find(uint32_t id, ChunkReader& chunk) const {
+    for (const auto& c : chunks) {
+        if (c.id == id) {
+            chunk = ChunkReader(c.data, c.size);
+            return true;
+        }
+    }
+    return false;
+}
+
+MappedFile::MappedFile(const std::string& path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return;
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping) {
+            // The view keeps the mapping alive after both handles are closed
+            view = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            if (view) length = static_cast<size_t>(fileSize.QuadPart);
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* p = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            view = static_cast<const uint8_t*>(p);
+            length = static_cast<size_t>(info.st_size);
+        }
+    }
+    ::close(fd);
+#endif
+}
+
+MappedFile::~MappedFile() {
+    if (!view) return;
+#ifdef _WIN32
+    UnmapViewOfFile(view);
+#else
+    munmap(const_cast<uint8_t*>(view), length);
+#endif
+}
+
+bool MappedFile::isOpen() const { return view != nullptr; }
+const uint8_t* MappedFile::data() const { return view; }
+size_t MappedFile::size() const { return length; }
+
+}
@@ -0,0 +1,114 @@
+// CHIP8CHAPA - Save-state file format header
+// Declares the chunked, checksummed container behind Chip8CPU::saveState/loadState
+
+#ifndef CHIP8_SAVESTATE_H
+#define CHIP8_SAVESTATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// File layout, all integers little-endian:
+//   "C8ST" magic, u32 format version, u32 chunk count
+//   per chunk: 4-character id, u32 payload size, u32 CRC-32 of the payload, payload
+// Readers skip chunks they do not know, so chunks can be added without a version bump;
+// the version only changes when the layout of an existing chunk does.
+namespace Chip8SaveState {
+    constexpr uint32_t MAGIC = 0x54533843; // "C8ST"
+    constexpr uint32_t VERSION = 1;
+    // Largest file Reader::open accepts (the chunks written today come to about 70 KB)
+    constexpr size_t MAX_FILE_SIZE = 1 << 20;
+
+    // Chunk ids are stored as their four characters in file order
+    constexpr uint32_t chunkId(const char (&id)[5]) {
+        return uint32_t(uint8_t(id[0])) | uint32_t(uint8_t(id[1])) << 8 |
+               uint32_t(uint8_t(id[2])) << 16 | uint32_t(uint8_t(id[3])) << 24;
+    }
+
+    // CRC-32 as used by zip and PNG
+    uint32_t crc32(const uint8_t* data, size_t size);
+
+    // Builds a file in memory, one chunk at a time
+    class Writer {
+    public:
+        Writer();
+        void beginChunk(uint32_t id);
+        // Fills in the size and CRC of the open chunk
+        void endChunk();
+
+        void u8(uint8_t value);
+        void u16(uint16_t value);
+        void u32(uint32_t value);
+        void u64(uint64_t value);
+        void bytes(const uint8_t* data, size_t size);
+
+        const std::vector<uint8_t>& data() const;
+
+    private:
+        std::vector<uint8_t> buffer;
+        size_t chunkStart = 0; // Offset of the open chunk's header
+        uint32_t chunkCount = 0;
+    };
+
+    // Reads the fields of one chunk payload. Reads past the end return zero and clear ok(),
+    // so a chunk can be decoded in one go and checked once
+    class ChunkReader {
+    public:
+        ChunkReader() = default;
+        ChunkReader(const uint8_t* data, size_t size);
+
+        uint8_t u8();
+        uint16_t u16();
+        uint32_t u32();
+        uint64_t u64();
+        // Points into the file itself (no copy); nullptr if fewer than size bytes are left
+        const uint8_t* bytes(size_t size);
+
+        size_t size() const;
+        bool ok() const;
+
+    private:
+        const uint8_t* data = nullptr;
+        size_t length = 0;
+        size_t offset = 0;
+        bool valid = true;
+    };
+
+    // Checks the header and the bounds and CRC of every chunk up front, so a
+    // truncated or corrupted file is rejected before any state is touched
+    class Reader {
+    public:
+        // data must stay valid while chunks are read
+        bool open(const uint8_t* data, size_t size);
+        // Payload of the first chunk with this id; false if there is none
+        bool find(uint32_t id, ChunkReader& chunk) const;
+
+    private:
+        struct Chunk {
+            uint32_t id;
+            const uint8_t* data;
+            size_t size;
+        };
+        std::vector<Chunk> chunks;
+    };
+
+    // Read-only mapping of a whole file (mmap, or MapViewOfFile on Windows)
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::string& path);
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool isOpen() const;
+        const uint8_t* data() const;
+        size_t size() const;
+
+    private:
+        const uint8_t* view = nullptr;
+        size_t length = 0;
+    };
+}
+
+#endif
@@ -1,13 +1,15 @@
 // CHIP8CHAPA - CHIP-8 Sound implementation
-// Handles beeper, XO-CHIP pattern playback, and audio output via SDL2
+// Handles beeper, XO-CHIP pattern playback, and sample generation for audio sinks
 
 #include "chip8_sound.h"
 #include <cmath>
 #include <array>
 #include <atomic>
 #include <cstring>
+#include <chrono>
+#include <thread>
 
-constexpr int CHIP8_SAMPLE_RATE = 44100;
+constexpr int CHIP8_SAMPLE_RATE = Chip8Sound::SAMPLE_RATE;
 constexpr int CHIP8_BEEP_FREQ = 440;
 constexpr int CHIP8_AMPLITUDE = 64;
 
@@ -21,28 +23,16 @@ namespace {
     }
 }
 
-std::array<uint8_t, XOCHIP_PATTERN_BYTES> patternBuffer = {};
-std::atomic<bool> patternPlaying = false;
-std::atomic<int> patternBit = 0;
-
-Chip8Sound::Chip8Sound() : buzzerOn(false), audioDevice(0), playing(false), phase(0) {
-    SDL_AudioSpec want{};
-    want.freq = CHIP8_SAMPLE_RATE;
-    want.format = AUDIO_U8;
-    want.channels = 1;
-    want.samples = 512;
-    want.callback = audioCallback;
-    want.userdata = this;
-    audioDevice = SDL_OpenAudioDevice(nullptr, 0, &want, nullptr, 0);
-    if (audioDevice != 0) {
-        SDL_PauseAudioDevice(audioDevice, 0);
-    }
-}
+Chip8Sound::Chip8Sound() : buzzerOn(false), playing(false), phase(0) {}
 
 Chip8Sound::~Chip8Sound() {
-    if (audioDevice != 0) {
-        SDL_CloseAudioDevice(audioDevice);
-    }
+    sink->detach(this);
+}
+
+void Chip8Sound::setSink(Chip8AudioSink* newSink) {
+    sink->detach(this);
+    sink = newSink ? newSink : &nullSink;
+    sink->attach(this);
 }
 
 void Chip8Sound::start() {
@@ -74,10 +64,7 @@ void Chip8Sound::playPattern(const uint8_t* pattern) {
 }
 
 void Chip8Sound::forceSilence() {
-    if (audioDevice != 0) {
-        SDL_PauseAudioDevice(audioDevice, 1);
-        SDL_PauseAudioDevice(audioDevice, 0);
-    }
+    sink->flush();
 }
 
 int Chip8Sound::getPhase() const { return phase; }
@@ -91,21 +78,20 @@ void Chip8Sound::setPlaying(bool p) { playing = p; }
 
 void Chip8Sound::playTestBeep() {
     start();
-    SDL_Delay(100);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
     stop();
 }
 
-void Chip8Sound::audioCallback(void* userdata, Uint8* stream, int len) {
-    Chip8Sound* self = static_cast<Chip8Sound*>(userdata);
-    if (self->muted) {
+void Chip8Sound::render(uint8_t* stream, int len) {
+    if (muted) {
         memset(stream, 128, len);
         return;
     }
-    if (!self->playing && !patternPlaying) {
+    if (!playing && !patternPlaying) {
         memset(stream, 128, len);
         return;
     }
-    int vol = self->volume;
+    int vol = volume;
     for (int i = 0; i < len; ++i) {
         if (patternPlaying) {
             int samplesPerBit = CHIP8_SAMPLE_RATE / XOCHIP_PATTERN_RATE;
@@ -121,11 +107,11 @@ void Chip8Sound::audioCallback(void* userdata, Uint8* stream, int len) {
             }
             continue;
         }
-        if (self->playing) {
+        if (playing) {
             int period = CHIP8_SAMPLE_RATE / CHIP8_BEEP_FREQ;
-            int base = ((self->phase < period / 2) ? (128 + CHIP8_AMPLITUDE) : (128 - CHIP8_AMPLITUDE));
+            int base = ((phase < period / 2) ? (128 + CHIP8_AMPLITUDE) : (128 - CHIP8_AMPLITUDE));
             stream[i] = 128 + ((base - 128) * vol) / 100;
-            self->phase = (self->phase + 1) % period;
+            phase = (phase + 1) % period;
         } else {
             stream[i] = 128;
         }
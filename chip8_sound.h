@@ -1,14 +1,39 @@
 // CHIP8CHAPA - CHIP-8 Sound header
-// Declares beeper, XO-CHIP pattern playback, and audio output API
+// Declares beeper, XO-CHIP pattern playback, and the audio sink interface
 
 #ifndef CHIP8_SOUND_H
 #define CHIP8_SOUND_H
 
-#include <SDL.h>
+#include <array>
 #include <atomic>
+#include <cstdint>
+
+class Chip8Sound;
+
+// Audio output backend: pulls samples from an attached Chip8Sound with Chip8Sound::render
+class Chip8AudioSink {
+public:
+    virtual ~Chip8AudioSink() = default;
+    // Start pulling samples from sound
+    virtual void attach(Chip8Sound* sound) = 0;
+    // Stop pulling samples from sound (no-op if another source is attached)
+    virtual void detach(Chip8Sound* sound) = 0;
+    // Drop queued samples so the output goes silent immediately
+    virtual void flush() = 0;
+};
+
+// Default sink: discards all audio and touches no device
+class NullAudioSink : public Chip8AudioSink {
+public:
+    void attach(Chip8Sound*) override {}
+    void detach(Chip8Sound*) override {}
+    void flush() override {}
+};
 
 class Chip8Sound {
 public:
+    static constexpr int SAMPLE_RATE = 44100; // render() produces unsigned 8-bit mono at this rate
+
     Chip8Sound();
     ~Chip8Sound();
     Chip8Sound(const Chip8Sound&) = delete;
@@ -16,6 +41,9 @@ public:
     Chip8Sound(Chip8Sound&&) = delete;
     Chip8Sound& operator=(Chip8Sound&&) = delete;
 
+    // Route audio to sink (not owned, must outlive this object); nullptr restores the null sink
+    void setSink(Chip8AudioSink* sink);
+
     // Start/stop the buzzer
     void start();
     void stop();
@@ -32,6 +60,9 @@ public:
     void setVolume(int percent); // 0-100
     void playTestBeep();
 
+    // Fills stream with len samples (called by the sink, possibly from an audio thread)
+    void render(uint8_t* stream, int len);
+
     int getPhase() const;
     void setPhase(int);
     bool getMuted() const;
@@ -41,12 +72,15 @@ public:
 
 private:
     std::atomic<bool> buzzerOn;
-    SDL_AudioDeviceID audioDevice;
-    static void audioCallback(void* userdata, Uint8* stream, int len);
     std::atomic<bool> playing;
     int phase;
     bool muted = false;
     int volume = 100;
+    std::array<uint8_t, 16> patternBuffer{};
+    std::atomic<bool> patternPlaying{false};
+    std::atomic<int> patternBit{0};
+    NullAudioSink nullSink;
+    Chip8AudioSink* sink = &nullSink;
 };
 
 #endif
\ No newline at end of file
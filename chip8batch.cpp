@@ -0,0 +1,442 @@
+// CHIP8CHAPA - Headless batch runner
+// Runs a manifest of ROM jobs on all cores and prints one JSON Lines record per job
+//
+// Usage: chip8batch <manifest> [-j threads] [-o output.jsonl]
+//
+// Manifest: one job per line, whitespace-separated key=value pairs ('#' starts a comment)
+//   rom=<path>          ROM file (required)
+//   variant=<name>      chip8 (default), schip or xochip
+//   quirks=<list>       comma-separated: shiftUsesVy, loadStoreIncrementI, jumpWithVx,
+//                       displayWait, or "none" (default: the variant's usual quirks)
+//   frames=<n>          60 Hz frames to run (default 600)
+//   seed=<n>            CXNN random seed (default 0)
+//   input=<path>        input script, one "<frame> <key 0-F> <down|up>" per line
+//   movie=<path>        replay a recorded movie instead (replaces rom, seed, input and frames;
+//                       the job runs until the movie ends)
+//   check=lockstep      differential check: runs the job with runFrame() and a copy with
+//                       runBlock() next to a reference CPU that steps one instruction at a
+//                       time with the decode cache off, compares them at every frame
+//                       boundary and reports the first divergence (rom jobs only)
+
+#include "chip8_cpu.h"
+#include "chip8_movie.h"
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct InputEvent {
+    uint64_t frame;
+    uint8_t key;
+    bool pressed;
+};
+
+struct Job {
+    std::string rom;
+    std::string variantName = "chip8";
+    Chip8CPU::Variant variant = Chip8CPU::Variant::CHIP8;
+    Chip8CPU::Quirks quirks;
+    bool customQuirks = false;
+    uint64_t frames = 600;
+    uint64_t seed = 0;
+    std::string input;
+    std::string movie;
+    bool lockstep = false;
+    std::string error; // Manifest problem, reported instead of running
+};
+
+std::string jsonEscape(const std::string& s) {
+    std::ostringstream out;
+    for (char c : s) {
+        switch (c) {
+        case '"': out << "\\\""; break;
+        case '\\': out << "\\\\"; break;
+        case '\n': out << "\\n"; break;
+        case '\t': out << "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec;
+            } else {
+                out << c;
+            }
+        }
+    }
+    return out.str();
+}
+
+// Accepts only a whole number in base (no sign, spaces or trailing characters)
+bool parseNumber(const std::string& text, uint64_t& value, int base = 10) {
+    const char* end = text.data() + text.size();
+    auto result = std::from_chars(text.data(), end, value, base);
+    return !text.empty() && result.ec == std::errc() && result.ptr == end;
+}
+
+bool parseQuirks(const std::string& value, Chip8CPU::Quirks& quirks) {
+    quirks = {false, false, false, false};
+    if (value == "none") return true;
+    std::istringstream ss(value);
+    std::string name;
+    while (std::getline(ss, name, ',')) {
+        if (name == "shiftUsesVy") quirks.shiftUsesVy = true;
+        else if (name == "loadStoreIncrementI") quirks.loadStoreIncrementI = true;
+        else if (name == "jumpWithVx") quirks.jumpWithVx = true;
+        else if (name == "displayWait") quirks.displayWait = true;
+        else return false;
+    }
+    return true;
+}
+
+Job parseJob(const std::string& line) {
+    Job job;
+    std::istringstream ss(line);
+    std::string field;
+    while (ss >> field) {
+        size_t eq = field.find('=');
+        if (eq == std::string::npos) {
+            job.error = "malformed field: " + field;
+            return job;
+        }
+        std::string key = field.substr(0, eq);
+        std::string value = field.substr(eq + 1);
+        if (key == "rom") {
+            job.rom = value;
+        } else if (key == "variant") {
+            job.variantName = value;
+            if (value == "chip8") job.variant = Chip8CPU::Variant::CHIP8;
+            else if (value == "schip") job.variant = Chip8CPU::Variant::SCHIP;
+            else if (value == "xochip") job.variant = Chip8CPU::Variant::XOCHIP;
+            else job.error = "unknown variant: " + value;
+        } else if (key == "quirks") {
+            job.customQuirks = true;
+            if (!parseQuirks(value, job.quirks)) job.error = "unknown quirk in: " + value;
+        } else if (key == "frames") {
+            if (!parseNumber(value, job.frames)) job.error = "malformed frames: " + value;
+        } else if (key == "seed") {
+            if (!parseNumber(value, job.seed)) job.error = "malformed seed: " + value;
+        } else if (key == "input") {
+            job.input = value;
+        } else if (key == "movie") {
+            job.movie = value;
+        } else if (key == "check") {
+            if (value == "lockstep") job.lockstep = true;
+            else job.error = "unknown check: " + value;
+        } else {
+            job.error = "unknown key: " + key;
+        }
+    }
+    if (job.rom.empty() && job.movie.empty() && job.error.empty()) job.error = "missing rom";
+    if (job.lockstep && !job.movie.empty() && job.error.empty()) job.error = "check=lockstep needs a rom job";
+    if (!job.customQuirks) job.quirks = Chip8CPU::defaultQuirks(job.variant);
+    return job;
+}
+
+bool loadInputScript(const std::string& path, std::vector<InputEvent>& events) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream ss(line);
+        uint64_t frame = 0, key = 0;
+        std::string keyName, state;
+        if (!(ss >> frame >> keyName >> state)) return false;
+        if (!parseNumber(keyName, key, 16) || key >= Chip8Input::NUM_KEYS) return false;
+        if (state != "down" && state != "up") return false;
+        events.push_back({frame, static_cast<uint8_t>(key), state == "down"});
+    }
+    return true;
+}
+
+// FNV-1a over the visible pixels and the display mode
+uint64_t hashFramebuffer(const Chip8Display& display) {
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](uint8_t byte) {
+        hash ^= byte;
+        hash *= 1099511628211ULL;
+    };
+    mix(static_cast<uint8_t>(display.getMode()));
+    for (int y = 0; y < display.height(); ++y) {
+        for (int x = 0; x < display.width(); ++x) {
+            mix(display.getPixel(x, y));
+        }
+    }
+    return hash;
+}
+
+const char* variantName(Chip8CPU::Variant variant) {
+    switch (variant) {
+    case Chip8CPU::Variant::SCHIP: return "schip";
+    case Chip8CPU::Variant::XOCHIP: return "xochip";
+    default: return "chip8";
+    }
+}
+
+const char* faultName(Chip8CPU::Fault fault) {
+    switch (fault) {
+    case Chip8CPU::Fault::StackOverflow: return "stack_overflow";
+    case Chip8CPU::Fault::StackUnderflow: return "stack_underflow";
+    case Chip8CPU::Fault::AddressOutOfRange: return "address_out_of_range";
+    default: return "none";
+    }
+}
+
+// Name of the first state that differs between the two CPUs, or "" if they agree
+std::string compareCPUs(Chip8CPU& a, Chip8CPU& b) {
+    if (a.getFault() != b.getFault()) return "fault";
+    if (a.getCycleCount() != b.getCycleCount()) return "cycle_count";
+    const Chip8Registers& ra = a.registers();
+    const Chip8Registers& rb = b.registers();
+    if (ra.getV() != rb.getV() || ra.I() != rb.I() || ra.PC() != rb.PC() || ra.SP() != rb.SP() ||
+        ra.getStack() != rb.getStack()) {
+        return "registers";
+    }
+    if (a.memory().size() != b.memory().size() ||
+        std::memcmp(a.memory().data(), b.memory().data(), a.memory().size()) != 0) {
+        return "memory";
+    }
+    const Chip8Display& da = a.display();
+    const Chip8Display& db = b.display();
+    if (da.getMode() != db.getMode() || da.getColorMode() != db.getColorMode() ||
+        da.plane(0) != db.plane(0) || da.plane(1) != db.plane(1)) {
+        return "display";
+    }
+    if (a.timers().getDelay() != b.timers().getDelay() || a.timers().getSound() != b.timers().getSound()) {
+        return "timers";
+    }
+    return "";
+}
+
+// Runs the rest of the current frame: cpu the way production does (runFrame, with the
+// idle fast-forward), blocks with runBlock() and reference one step() at a time
+void runLockstepFrame(Chip8CPU& cpu, Chip8CPU& blocks, Chip8CPU& reference) {
+    uint64_t frame = cpu.getFrameCount();
+    while (cpu.getFrameCount() == frame && cpu.runFrame() != Chip8CPU::RunResult::Fault) {}
+    while (blocks.getFrameCount() == frame && blocks.getFault() == Chip8CPU::Fault::None) {
+        blocks.runBlock(blocks.getCyclesPerFrame());
+    }
+    while (reference.getFrameCount() == frame && reference.getFault() == Chip8CPU::Fault::None) reference.step();
+}
+
+// Runs the job on all three CPUs frame by frame and compares the fast paths with the
+// reference at every frame boundary (and after a fault). Returns the first divergence as
+// "<path> <state>" ("" if none); divergenceCycle is the reference's count at that point
+std::string runLockstep(Chip8CPU& cpu, Chip8CPU& blocks, Chip8CPU& reference, const Job& job,
+                        const std::vector<InputEvent>& events, uint64_t& divergenceCycle) {
+    size_t nextEvent = 0;
+    while (cpu.getFrameCount() < job.frames && cpu.getFault() == Chip8CPU::Fault::None) {
+        uint64_t frame = cpu.getFrameCount();
+        while (nextEvent < events.size() && events[nextEvent].frame <= frame) {
+            for (Chip8CPU* c : {&cpu, &blocks, &reference}) c->input().setKey(events[nextEvent].key, events[nextEvent].pressed);
+            ++nextEvent;
+        }
+        runLockstepFrame(cpu, blocks, reference);
+        divergenceCycle = reference.getCycleCount();
+        std::string diverged = compareCPUs(cpu, reference);
+        if (!diverged.empty()) return "runFrame " + diverged;
+        diverged = compareCPUs(blocks, reference);
+        if (!diverged.empty()) return "runBlock " + diverged;
+    }
+    return "";
+}
+
+std::string runJob(size_t index, const Job& job) {
+    std::ostringstream out;
+    out << "{\"job\":" << index << ",\"rom\":\"" << jsonEscape(job.rom) << "\"";
+    std::string error = job.error;
+    std::vector<uint8_t> romData;
+    std::vector<InputEvent> events;
+    Chip8Movie movie;
+    if (error.empty() && !job.movie.empty() && !movie.load(job.movie)) error = "cannot read movie";
+    if (error.empty() && job.movie.empty()) {
+        std::ifstream rom(job.rom, std::ios::binary);
+        if (!rom) error = "cannot open rom";
+        else romData.assign(std::istreambuf_iterator<char>(rom), std::istreambuf_iterator<char>());
+    }
+    if (error.empty() && !job.input.empty() && !loadInputScript(job.input, events)) {
+        error = "cannot read input script";
+    }
+    if (!error.empty()) {
+        out << ",\"variant\":\"" << jsonEscape(job.variantName) << "\",\"error\":\"" << jsonEscape(error) << "\"}";
+        return out.str();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::string lockstepResult;
+    uint64_t divergenceCycle = 0;
+    auto cpu = std::make_unique<Chip8CPU>(job.variant);
+    cpu->setQuirks(job.quirks);
+    cpu->seedRandom(job.seed);
+    if (!job.movie.empty()) {
+        if (!movie.startPlayback(*cpu)) {
+            out << ",\"variant\":\"" << jsonEscape(job.variantName) << "\",\"error\":\"movie start state does not match this build\"}";
+            return out.str();
+        }
+        while (!movie.isFinished(*cpu) && cpu->getFault() == Chip8CPU::Fault::None) movie.runFrame(*cpu);
+    } else {
+        if (romData.size() + Chip8Memory::PROGRAM_START > cpu->memory().size()) {
+            out << ",\"variant\":\"" << jsonEscape(job.variantName) << "\",\"error\":\"rom too large\"}";
+            return out.str();
+        }
+        cpu->memory().loadROM(romData);
+        if (job.lockstep) {
+            auto blocks = std::make_unique<Chip8CPU>(job.variant);
+            auto reference = std::make_unique<Chip8CPU>(job.variant);
+            for (Chip8CPU* c : {blocks.get(), reference.get()}) {
+                c->setQuirks(job.quirks);
+                c->seedRandom(job.seed);
+                c->memory().loadROM(romData);
+            }
+            reference->setDecodeCacheEnabled(false);
+            lockstepResult = runLockstep(*cpu, *blocks, *reference, job, events, divergenceCycle);
+            if (lockstepResult.empty()) lockstepResult = "match";
+        }
+        size_t nextEvent = 0;
+        while (!job.lockstep && cpu->getFrameCount() < job.frames && cpu->getFault() == Chip8CPU::Fault::None) {
+            uint64_t frame = cpu->getFrameCount();
+            while (nextEvent < events.size() && events[nextEvent].frame <= frame) {
+                cpu->input().setKey(events[nextEvent].key, events[nextEvent].pressed);
+                ++nextEvent;
+            }
+            while (cpu->getFrameCount() == frame && cpu->runFrame() != Chip8CPU::RunResult::Fault) {}
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // A movie's start state decides the variant
+    out << ",\"variant\":\"" << variantName(cpu->getVariant()) << "\""
+        << ",\"frames\":" << cpu->getFrameCount()
+        << ",\"cycles\":" << cpu->getCycleCount()
+        << ",\"skipped_cycles\":" << cpu->getSkippedCycleCount()
+        << ",\"fault\":\"" << faultName(cpu->getFault()) << "\""
+        << ",\"pc\":" << cpu->registers().PC()
+        << ",\"fb_hash\":\"" << std::hex << std::setw(16) << std::setfill('0') << hashFramebuffer(cpu->display())
+        << std::dec << "\""
+        << ",\"wall_ms\":" << std::fixed << std::setprecision(3) << seconds * 1000.0
+        << ",\"mips\":" << (seconds > 0 ? cpu->getCycleCount() / seconds / 1e6 : 0.0);
+    if (job.lockstep) {
+        out << ",\"lockstep\":\"" << lockstepResult << "\"";
+        if (lockstepResult != "match") out << ",\"divergence_cycle\":" << divergenceCycle;
+    }
+    out << "}";
+    return out.str();
+}
+
+// Per-worker deques: a worker pops from the back of its own queue and steals from the front of others
+class WorkStealingQueues {
+public:
+    explicit WorkStealingQueues(size_t workers) : queues(workers) {}
+
+    void push(size_t worker, size_t job) {
+        std::lock_guard<std::mutex> lock(queues[worker].mutex);
+        queues[worker].jobs.push_back(job);
+    }
+
+    bool pop(size_t worker, size_t& job) {
+        {
+            Queue& own = queues[worker];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.jobs.empty()) {
+                job = own.jobs.back();
+                own.jobs.pop_back();
+                return true;
+            }
+        }
+        for (size_t i = 1; i < queues.size(); ++i) {
+            Queue& victim = queues[(worker + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.jobs.empty()) {
+                job = victim.jobs.front();
+                victim.jobs.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<size_t> jobs;
+    };
+    std::vector<Queue> queues;
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string manifestPath;
+    std::string outputPath;
+    unsigned threads = std::thread::hardware_concurrency();
+    bool badArguments = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc) {
+            uint64_t count = 0;
+            if (parseNumber(argv[++i], count) && count <= 1024) threads = static_cast<unsigned>(count);
+            else badArguments = true;
+        } else if (arg == "-o" && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else {
+            manifestPath = arg;
+        }
+    }
+    if (manifestPath.empty() || badArguments) {
+        std::cerr << "Usage: chip8batch <manifest> [-j threads] [-o output.jsonl]" << std::endl;
+        return 1;
+    }
+    if (threads == 0) threads = 1;
+
+    std::ifstream manifest(manifestPath);
+    if (!manifest) {
+        std::cerr << "Failed to open manifest: " << manifestPath << std::endl;
+        return 1;
+    }
+    std::vector<Job> jobs;
+    std::string line;
+    while (std::getline(manifest, line)) {
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+        jobs.push_back(parseJob(line));
+    }
+
+    std::vector<std::string> results(jobs.size());
+    WorkStealingQueues queues(threads);
+    for (size_t i = 0; i < jobs.size(); ++i) queues.push(i % threads, i);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (unsigned w = 0; w < threads; ++w) {
+        workers.emplace_back([&, w] {
+            size_t job = 0;
+            while (queues.pop(w, job)) results[job] = runJob(job, jobs[job]);
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::ofstream file;
+    if (!outputPath.empty()) {
+        file.open(outputPath);
+        if (!file) {
+            std::cerr << "Failed to open output: " << outputPath << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = outputPath.empty() ? std::cout : file;
+    for (const auto& result : results) out << result << "\n";
+    std::cerr << jobs.size() << " jobs on " << threads << " threads in " << seconds << " s" << std::endl;
+    return 0;
+}
@@ -0,0 +1,178 @@
+// CHIP8CHAPA - Benchmarks
+// Measures interpreter throughput for every variant and quirk combination, and the
+// display scroll engine
+//
+// Usage: chip8bench [-t seconds] [cpu|scroll]...
+//
+// cpu runs a built-in ALU/memory/jump loop on each Variant with each of the 16 Quirks
+// combinations and prints millions of guest instructions per second. The loop never
+// waits or idles, so no cycles are fast-forwarded.
+// scroll times each Chip8Display scroll for every resolution and plane selection and
+// prints nanoseconds per call.
+// Without a section both run. -t sets the time per case (default 0.2).
+
+#include "chip8_cpu.h"
+#include "chip8_display.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Loop body: every templated handler family (8XY1-3, 8XY6/8XYE, BNNN, FX55/FX65),
+// 16 instructions per iteration
+const std::vector<uint8_t> CPU_LOOP = [] {
+    std::vector<uint8_t> rom(0x102, 0);
+    const uint16_t program[] = {
+        0x6101, 0x6202, 0x6303, 0x6404, 0x6505, // 200: V1-V5 = 1-5
+        0xA400,                                 // 20A: loop: I = 0x400
+        0x8014, 0x8121, 0x8232, 0x8343,         //      add, or, and, xor
+        0x8456, 0x854E, 0x8015,                 //      shift right, shift left, sub
+        0xF355, 0xF365,                         //      store and load V0-V3
+        0x6000, 0x6300, 0xB300,                 //      V0 = V3 = 0, jump to 0x300 (V0 or V3)
+        0x7601, 0x3600, 0x120A,                 // 224: count in V6 and loop
+        0x7701, 0x120A,
+    };
+    size_t offset = 0;
+    for (uint16_t opcode : program) {
+        rom[offset++] = static_cast<uint8_t>(opcode >> 8);
+        rom[offset++] = static_cast<uint8_t>(opcode);
+    }
+    rom[0x100] = 0x12; // 300: jump back to 0x224
+    rom[0x101] = 0x24;
+    return rom;
+}();
+
+const char* variantName(Chip8CPU::Variant variant) {
+    switch (variant) {
+    case Chip8CPU::Variant::SCHIP: return "schip";
+    case Chip8CPU::Variant::XOCHIP: return "xochip";
+    default: return "chip8";
+    }
+}
+
+std::string quirkNames(const Chip8CPU::Quirks& quirks) {
+    std::string names;
+    auto add = [&names](bool on, const char* name) {
+        if (!on) return;
+        if (!names.empty()) names += ",";
+        names += name;
+    };
+    add(quirks.shiftUsesVy, "shiftUsesVy");
+    add(quirks.loadStoreIncrementI, "loadStoreIncrementI");
+    add(quirks.jumpWithVx, "jumpWithVx");
+    add(quirks.displayWait, "displayWait");
+    return names.empty() ? "none" : names;
+}
+
+bool sameQuirks(const Chip8CPU::Quirks& a, const Chip8CPU::Quirks& b) {
+    return a.shiftUsesVy == b.shiftUsesVy && a.loadStoreIncrementI == b.loadStoreIncrementI &&
+           a.jumpWithVx == b.jumpWithVx && a.displayWait == b.displayWait;
+}
+
+// Millions of instructions per second over about seconds of running
+double measureCPU(Chip8CPU::Variant variant, const Chip8CPU::Quirks& quirks, double seconds) {
+    Chip8CPU cpu(variant);
+    cpu.setQuirks(quirks);
+    cpu.memory().loadROM(CPU_LOOP);
+    // Long frames so the per-batch bookkeeping does not dominate
+    cpu.setCyclesPerFrame(100000);
+    cpu.runFrame(); // Warm the decode cache
+    uint64_t startCycles = cpu.getCycleCount();
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0.0;
+    do {
+        for (int i = 0; i < 10; ++i) cpu.runFrame();
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < seconds);
+    if (cpu.getFault() != Chip8CPU::Fault::None) return 0.0;
+    return (cpu.getCycleCount() - startCycles) / elapsed / 1e6;
+}
+
+void benchCPU(double seconds) {
+    std::printf("%-8s %-58s %10s\n", "variant", "quirks (* = variant default)", "MIPS");
+    for (auto variant : {Chip8CPU::Variant::CHIP8, Chip8CPU::Variant::SCHIP, Chip8CPU::Variant::XOCHIP}) {
+        Chip8CPU::Quirks defaults = Chip8CPU::defaultQuirks(variant);
+        for (int bits = 0; bits < 16; ++bits) {
+            Chip8CPU::Quirks quirks;
+            quirks.shiftUsesVy = (bits & 1) != 0;
+            quirks.loadStoreIncrementI = (bits & 2) != 0;
+            quirks.jumpWithVx = (bits & 4) != 0;
+            quirks.displayWait = (bits & 8) != 0;
+            std::string label = quirkNames(quirks) + (sameQuirks(quirks, defaults) ? " *" : "");
+            std::printf("%-8s %-58s %10.1f\n", variantName(variant), label.c_str(), measureCPU(variant, quirks, seconds));
+        }
+    }
+}
+
+// Nanoseconds per call of scroll over about seconds of running. Scrolls move whole rows
+// and words, so their cost does not depend on the pixels shown
+template <typename Scroll>
+double measureScroll(Chip8Display& display, Scroll scroll, double seconds) {
+    uint64_t calls = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0.0;
+    do {
+        for (int i = 0; i < 1000; ++i) scroll(display);
+        calls += 1000;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < seconds);
+    return elapsed / calls * 1e9;
+}
+
+void benchScroll(double seconds) {
+    struct PlaneSet {
+        const char* name;
+        Chip8Display::ColorMode colorMode;
+        uint8_t planes;
+    };
+    const PlaneSet planeSets[] = {
+        {"mono", Chip8Display::ColorMode::Mono, 1},
+        {"2bpp p0", Chip8Display::ColorMode::XOCHIP_2BPP, 1},
+        {"2bpp p1", Chip8Display::ColorMode::XOCHIP_2BPP, 2},
+        {"2bpp p0+p1", Chip8Display::ColorMode::XOCHIP_2BPP, 3},
+    };
+    std::printf("%-6s %-10s %10s %10s %10s %10s\n", "res", "planes", "up 4 ns", "down 4 ns", "left ns", "right ns");
+    for (auto mode : {Chip8Display::Mode::LowRes, Chip8Display::Mode::HighRes}) {
+        for (const PlaneSet& set : planeSets) {
+            Chip8Display display;
+            display.setMode(mode);
+            display.setColorMode(set.colorMode);
+            display.setActivePlanes(set.planes);
+            double up = measureScroll(display, [](Chip8Display& d) { d.scrollUp(4); }, seconds);
+            double down = measureScroll(display, [](Chip8Display& d) { d.scrollDown(4); }, seconds);
+            double left = measureScroll(display, [](Chip8Display& d) { d.scrollLeft(); }, seconds);
+            double right = measureScroll(display, [](Chip8Display& d) { d.scrollRight(); }, seconds);
+            std::printf("%-6s %-10s %10.1f %10.1f %10.1f %10.1f\n", mode == Chip8Display::Mode::HighRes ? "hires" : "lores",
+                        set.name, up, down, left, right);
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    double seconds = 0.2;
+    bool cpu = false, scroll = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-t" && i + 1 < argc) {
+            seconds = std::atof(argv[++i]);
+        } else if (arg == "cpu") {
+            cpu = true;
+        } else if (arg == "scroll") {
+            scroll = true;
+        } else {
+            std::fprintf(stderr, "Usage: chip8bench [-t seconds] [cpu|scroll]...\n");
+            return 1;
+        }
+    }
+    if (seconds <= 0.0) seconds = 0.2;
+    if (!cpu && !scroll) cpu = scroll = true;
+    if (cpu) benchCPU(seconds);
+    if (cpu && scroll) std::printf("\n");
+    if (scroll) benchScroll(seconds);
+    return 0;
+}
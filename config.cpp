@@ -2,6 +2,7 @@
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <cstdio>
 
 Config g_config;
 
@@ -45,6 +46,15 @@ void Config::load(const std::string& path) {
             windowScale = std::stoi(value);
         } else if (key == "mode") {
             mode = std::stoi(value);
+        } else if (key == "runAheadFrames") {
+            runAheadFrames = std::stoi(value);
+        } else if (key == "palette") {
+            std::istringstream ss(value);
+            for (int i = 0; i < 4; ++i) {
+                std::string color;
+                if (!std::getline(ss, color, ',')) break;
+                palette[i] = static_cast<uint32_t>(std::stoul(trim(color), nullptr, 16)) & 0xFFFFFF;
+            }
         }
     }
 }
@@ -68,4 +78,13 @@ void Config::save(const std::string& path) const {
     out << "\n";
     out << "windowScale=" << windowScale << "\n";
     out << "mode=" << mode << "\n";
+    out << "runAheadFrames=" << runAheadFrames << "\n";
+    out << "palette=";
+    for (int i = 0; i < 4; ++i) {
+        char color[8];
+        snprintf(color, sizeof(color), "%06X", palette[i] & 0xFFFFFF);
+        if (i > 0) out << ",";
+        out << color;
+    }
+    out << "\n";
 } 
\ No newline at end of file
@@ -11,6 +11,9 @@ struct Config {
     std::array<int32_t, 16> inputKeymap = {};
     int windowScale = 10;
     int mode = 0;
+    int runAheadFrames = 0; // Frames emulated ahead of the presented state (0 = off)
+    // Display colours as 0xRRGGBB, indexed by XO-CHIP plane bits (mono uses 0 and 3)
+    std::array<uint32_t, 4> palette = {0x000000, 0x555555, 0xAAAAAA, 0xFFFFFF};
 
     void load(const std::string& path);
     void save(const std::string& path) const;
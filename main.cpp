@@ -3,6 +3,10 @@
 
 #include <SDL.h>
 #include "chip8_cpu.h"
+#include "chip8_rewind.h"
+#include "chip8_movie.h"
+#include "sdl_audio_sink.h"
+#include "sdl_display_renderer.h"
 #include <iostream>
 #include <chrono>
 #include <thread>
@@ -11,6 +15,7 @@
 #include <functional>
 #include <deque>
 #include <algorithm>
+#include <memory>
 #ifdef _WIN32
 #include <windows.h>
 #include <commdlg.h>
@@ -75,6 +80,7 @@ constexpr int LOWRES_SCALE = 10;
 constexpr int HIRES_SCALE = 5;
 constexpr int INSTR_PER_SECOND = 700;
 constexpr int TIMER_HZ = 60;
+constexpr int MAX_RUN_AHEAD_FRAMES = 4;
 
 // CHIP-8 keypad layout (default SDL key mapping)
 SDL_Keycode keymap[16] = {
@@ -134,39 +140,17 @@ void resizeWindow(SDL_Window* window, const Chip8Display& display) {
     SDL_SetWindowSize(window, w, h);
 }
 
-void renderDisplay(SDL_Window* window, SDL_Renderer* renderer, const Chip8Display& display) {
-    int winW, winH;
-    SDL_GetWindowSize(window, &winW, &winH);
-    int w = display.width();
-    int h = display.height();
-    float scaleX = static_cast<float>(winW) / w;
-    float scaleY = static_cast<float>(winH) / h;
-    float scale = (scaleX < scaleY) ? scaleX : scaleY;
-    if (scale < 1.0f) scale = 1.0f;
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
-    for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x) {
-            uint8_t pixel = display.getPixel(x, y);
-            if (pixel) {
-                uint8_t color = (display.getColorMode() == Chip8Display::ColorMode::XOCHIP_2BPP) ? (pixel * 85) : 255;
-                SDL_SetRenderDrawColor(renderer, color, color, color, 255);
-                SDL_Rect rect = { static_cast<int>(x * scale), static_cast<int>(y * scale), static_cast<int>(scale), static_cast<int>(scale) };
-                SDL_RenderFillRect(renderer, &rect);
-            }
-        }
-    }
-    SDL_RenderPresent(renderer);
-}
-
 #ifdef _WIN32
 static int windowScale = LOWRES_SCALE;
+static int stateSlot = 1; // Save-state slot used by Ctrl+S/Ctrl+L (1-9, F6/F7 to change)
 static bool menuPaused = false;
 static bool* g_romLoaded = nullptr;
 static std::string* g_currentRomPath = nullptr;
 static std::vector<uint8_t>* g_currentRomData = nullptr;
 static bool* g_paused = nullptr;
 static Chip8CPU* g_cpu = nullptr;
+static Chip8Rewind* g_rewind = nullptr;
+static Chip8Movie* g_movie = nullptr;
 static SDL_Window* g_window = nullptr;
 static SDL_Renderer* g_renderer = nullptr;
 static Chip8Display::Mode* g_lastMode = nullptr;
@@ -429,6 +413,12 @@ void updateMenuBar() {
     HMENU hStatesMenu = CreatePopupMenu();
     AppendMenuA(hStatesMenu, MF_STRING, 2301, "Save State\tCtrl+S");
     AppendMenuA(hStatesMenu, MF_STRING, 2302, "Load State\tCtrl+L");
+    HMENU hSlotMenu = CreatePopupMenu();
+    for (int slot = 1; slot <= 9; ++slot) {
+        std::string label = "Slot " + std::to_string(slot);
+        AppendMenuA(hSlotMenu, MF_STRING | (slot == stateSlot ? MF_CHECKED : 0), 2310 + slot, label.c_str());
+    }
+    AppendMenuA(hStatesMenu, MF_POPUP, (UINT_PTR)hSlotMenu, "Slot\tF6/F7");
     AppendMenuA(hOptionsMenu, MF_POPUP, (UINT_PTR)hStatesMenu, "States");
     AppendMenuA(hMenuBar, MF_POPUP, (UINT_PTR)hOptionsMenu, "Options");
     HMENU hHelpMenu = CreatePopupMenu();
@@ -462,12 +452,26 @@ std::string getStatesDir() {
     return statesDir;
 }
 
-std::string getStateSlotPath() {
+// Save states are named files in the states directory: <name>.ch8s
+std::string getStateSlotPath(const std::string& name) {
     return getStatesDir() +
 #ifdef _WIN32
-        "\\slot1.ch8s";
+        "\\" + name + ".ch8s";
 #else
-        "/slot1.ch8s";
+        "/" + name + ".ch8s";
+#endif
+}
+
+std::string getStateSlotName(int slot) {
+    return "slot" + std::to_string(slot);
+}
+
+std::string getMoviePath() {
+    return getStatesDir() +
+#ifdef _WIN32
+        "\\movie.c8m";
+#else
+        "/movie.c8m";
 #endif
 }
 
@@ -507,7 +511,9 @@ static void SDLCALL menuHandler(void* userdata, void* hWnd, unsigned int message
                     g_currentRomPath->clear();
                     g_currentRomData->clear();
                     *g_paused = false;
-                    new (g_cpu) Chip8CPU(Chip8CPU::Variant::CHIP8); 
+                    g_rewind->clear();
+                    g_movie->stop();
+                    g_cpu->reset(Chip8CPU::Variant::CHIP8, Chip8CPU::defaultQuirks(Chip8CPU::Variant::CHIP8));
                     SDL_SetRenderDrawColor(g_renderer, 0, 0, 0, 255);
                     SDL_RenderClear(g_renderer);
                     SDL_RenderPresent(g_renderer);
@@ -528,14 +534,9 @@ static void SDLCALL menuHandler(void* userdata, void* hWnd, unsigned int message
                 break;
             case 2002: { /* Reset (Ctrl+R) */
                 if (g_romLoaded && *g_romLoaded && g_cpu && g_currentRomData && g_lastMode && g_window) {
-                    new (g_cpu) Chip8CPU(g_cpu->getVariant());
-                    if (g_cpu->getVariant() == Chip8CPU::Variant::CHIP8) {
-                        g_cpu->setQuirks({true, true, false});
-                    } else if (g_cpu->getVariant() == Chip8CPU::Variant::SCHIP) {
-                        g_cpu->setQuirks({false, false, true});
-                    } else {
-                        g_cpu->setQuirks({true, true, false});
-                    }
+                    g_rewind->clear();
+                    g_movie->stop();
+                    g_cpu->reset(g_cpu->getVariant(), Chip8CPU::defaultQuirks(g_cpu->getVariant()));
                     g_cpu->memory().loadROM(*g_currentRomData);
                     resizeWindow(g_window, g_cpu->display());
                     *g_lastMode = g_cpu->display().getMode();
@@ -546,8 +547,9 @@ static void SDLCALL menuHandler(void* userdata, void* hWnd, unsigned int message
             }
             case 2201: /* Mode: CHIP-8 (F1) */
                 if (g_cpu && g_currentRomData && g_lastMode && g_window) {
-                    new (g_cpu) Chip8CPU(Chip8CPU::Variant::CHIP8);
-                    g_cpu->setQuirks({true, true, false});
+                    g_rewind->clear();
+                    g_movie->stop();
+                    g_cpu->reset(Chip8CPU::Variant::CHIP8, Chip8CPU::defaultQuirks(Chip8CPU::Variant::CHIP8));
                     if (g_currentRomData && !g_currentRomData->empty())
                         g_cpu->memory().loadROM(*g_currentRomData);
                     resizeWindow(g_window, g_cpu->display());
@@ -559,8 +561,9 @@ static void SDLCALL menuHandler(void* userdata, void* hWnd, unsigned int message
                 break;
             case 2202: /* Mode: SuperChip (F1) */
                 if (g_cpu && g_currentRomData && g_lastMode && g_window) {
-                    new (g_cpu) Chip8CPU(Chip8CPU::Variant::SCHIP);
-                    g_cpu->setQuirks({false, false, true});
+                    g_rewind->clear();
+                    g_movie->stop();
+                    g_cpu->reset(Chip8CPU::Variant::SCHIP, Chip8CPU::defaultQuirks(Chip8CPU::Variant::SCHIP));
                     if (g_currentRomData && !g_currentRomData->empty())
                         g_cpu->memory().loadROM(*g_currentRomData);
                     resizeWindow(g_window, g_cpu->display());
@@ -572,8 +575,9 @@ static void SDLCALL menuHandler(void* userdata, void* hWnd, unsigned int message
                 break;
             case 2203: /* Mode: XO-Chip (F1) */
                 if (g_cpu && g_currentRomData && g_lastMode && g_window) {
-                    new (g_cpu) Chip8CPU(Chip8CPU::Variant::XOCHIP);
-                    g_cpu->setQuirks({true, true, false});
+                    g_rewind->clear();
+                    g_movie->stop();
+                    g_cpu->reset(Chip8CPU::Variant::XOCHIP, Chip8CPU::defaultQuirks(Chip8CPU::Variant::XOCHIP));
                     if (g_currentRomData && !g_currentRomData->empty())
                         g_cpu->memory().loadROM(*g_currentRomData);
                     resizeWindow(g_window, g_cpu->display());
@@ -624,13 +628,15 @@ static void SDLCALL menuHandler(void* userdata, void* hWnd, unsigned int message
                 break;
             case 2301: /* Save State (Ctrl+S) */
                 if (g_cpu) {
-                    bool ok = g_cpu->saveState(getStateSlotPath());
+                    bool ok = g_cpu->saveState(getStateSlotPath(getStateSlotName(stateSlot)));
                     MessageBoxA((HWND)hWnd, ok ? "State saved!" : "Save failed!", "Save State", MB_OK | (ok ? MB_ICONINFORMATION : MB_ICONERROR));
                 }
                 break;
             case 2302: /* Load State (Ctrl+L) */
                 if (g_cpu) {
-                    bool ok = g_cpu->loadState(getStateSlotPath());
+                    bool ok = g_cpu->loadState(getStateSlotPath(getStateSlotName(stateSlot)));
+                    // The loaded machine is not the one the movie records or replays
+                    if (ok && g_movie) g_movie->stop();
                     MessageBoxA((HWND)hWnd, ok ? "State loaded!" : "Load failed!", "Load State", MB_OK | (ok ? MB_ICONINFORMATION : MB_ICONERROR));
                 }
                 break;
@@ -641,6 +647,10 @@ static void SDLCALL menuHandler(void* userdata, void* hWnd, unsigned int message
                     MB_OK | MB_ICONINFORMATION);
                 break;
             default:
+                if (cmd >= 2311 && cmd <= 2319) { /* State slot 1-9 (F6/F7) */
+                    stateSlot = cmd - 2310;
+                    updateMenuBar();
+                }
                 break;
         }
     }
@@ -703,7 +713,7 @@ bool saveScreenshot(SDL_Window* window, SDL_Renderer* renderer) {
     return ok != 0;
 }
 
-void setWindowTitle(SDL_Window* window, const std::string& romPath) {
+void setWindowTitle(SDL_Window* window, const std::string& romPath, const std::string& status = "") {
     std::string title = "CHIP8CHAPA";
     if (!romPath.empty()) {
         size_t slash = romPath.find_last_of("/\\");
@@ -712,6 +722,7 @@ void setWindowTitle(SDL_Window* window, const std::string& romPath) {
         if (dot != std::string::npos) fname = fname.substr(0, dot);
         title += " - " + fname;
     }
+    if (!status.empty()) title += " [" + status + "]";
     SDL_SetWindowTitle(window, title.c_str());
 }
 
@@ -742,7 +753,12 @@ int main(int argc, char* argv[]) {
     Chip8CPU::Variant initialVariant = Chip8CPU::Variant::CHIP8;
     if (g_config.mode == 1) initialVariant = Chip8CPU::Variant::SCHIP;
     else if (g_config.mode == 2) initialVariant = Chip8CPU::Variant::XOCHIP;
+    SDLAudioSink audioSink;
+    // Destroyed before the SDL renderer that owns its texture
+    auto displayRenderer = std::make_unique<SDLDisplayRenderer>(renderer);
+    displayRenderer->setPalette(g_config.palette);
     Chip8CPU cpu(initialVariant);
+    cpu.sound().setSink(&audioSink);
     if (initialVariant == Chip8CPU::Variant::CHIP8) {
         cpu.setQuirks({true, true, false});
     } else if (initialVariant == Chip8CPU::Variant::SCHIP) {
@@ -750,6 +766,18 @@ int main(int argc, char* argv[]) {
     } else {
         cpu.setQuirks({true, true, false});
     }
+    // Last minute of play, stepped back while Backspace is held
+    Chip8Rewind rewind(60 * 60, 60);
+    bool rewinding = false;
+    // Input movie: F5 starts/stops recording, F8 replays the last recording
+    Chip8Movie movie;
+    // Run-ahead: present the screen N frames past the real state, then roll back (0 = off)
+    int runAheadFrames = std::min(std::max(g_config.runAheadFrames, 0), MAX_RUN_AHEAD_FRAMES);
+    std::vector<uint8_t> runAheadState;
+    Chip8Display runAheadDisplay;
+    uint64_t runAheadFrame = UINT64_MAX; // Real frame runAheadDisplay was computed from
+    double runAheadCost = 0.0;           // Seconds spent running ahead since the last report
+    int runAheadSamples = 0;
     auto lastMode = cpu.display().getMode();
 #ifdef _WIN32
     g_window = window;
@@ -769,6 +797,8 @@ int main(int argc, char* argv[]) {
     g_currentRomData = &currentRomData;
     g_paused = &paused;
     g_cpu = &cpu;
+    g_rewind = &rewind;
+    g_movie = &movie;
     g_lastMode = &lastMode;
     static std::function<bool(const std::string&)> loadROM = [&](const std::string& romPath) -> bool {
         std::ifstream rom(romPath, std::ios::binary);
@@ -777,8 +807,9 @@ int main(int argc, char* argv[]) {
             return false;
         }
         std::vector<uint8_t> romData((std::istreambuf_iterator<char>(rom)), std::istreambuf_iterator<char>());
-        new (&cpu) Chip8CPU(Chip8CPU::Variant::CHIP8); 
-        cpu.setQuirks({true, true, false});
+        rewind.clear();
+        movie.stop();
+        cpu.reset(Chip8CPU::Variant::CHIP8, Chip8CPU::defaultQuirks(Chip8CPU::Variant::CHIP8));
         cpu.memory().loadROM(romData);
         resizeWindow(window, cpu.display());
         lastMode = cpu.display().getMode();
@@ -811,25 +842,36 @@ int main(int argc, char* argv[]) {
     SDL_RenderClear(renderer);
     SDL_RenderPresent(renderer);
 
-    double instrDelay;
-    if (cpu.getVariant() == Chip8CPU::Variant::CHIP8) {
-        instrDelay = 1.0 / 700.0;
-    } else if (cpu.getVariant() == Chip8CPU::Variant::SCHIP) {
-        instrDelay = 1.0 / 1000.0;
-    } else { 
-        instrDelay = 1.0 / 2000.0;
-    }
-    double timerDelay = 1.0 / TIMER_HZ;
-    double instrAccum = 0.0, timerAccum = 0.0;
-    auto lastTimer = std::chrono::high_resolution_clock::now();
-    auto lastInstr = lastTimer;
+    // Display generation on screen; frames whose display has not changed since are not drawn
+    // again. The CPU keeps generations unique across reset, restore and run-ahead copies
+    constexpr uint64_t REDRAW = UINT64_MAX;         // Draw the next frame whatever it shows
+    constexpr uint64_t BLANK_SCREEN = UINT64_MAX - 1; // The cleared no-ROM screen is shown
+    uint64_t presentedGeneration = BLANK_SCREEN;
+
+    // The CPU runs a variant-specific number of instructions per 60 Hz frame
+    double frameDelay = 1.0 / TIMER_HZ;
+    double frameAccum = 0.0;
+    auto lastFrame = std::chrono::high_resolution_clock::now();
+
+    // Window title suffixes for the movie and run-ahead state
+    std::string movieStatus;
+    std::string runAheadStatus;
+    std::string slotStatus;
+    auto updateTitle = [&]() {
+        std::string status;
+        for (const std::string* part : {&movieStatus, &runAheadStatus, &slotStatus}) {
+            if (part->empty()) continue;
+            if (!status.empty()) status += ", ";
+            status += *part;
+        }
+        setWindowTitle(window, currentRomPath, status);
+    };
 
     while (running) {
         auto now = std::chrono::high_resolution_clock::now();
-        double elapsed = std::chrono::duration<double>(now - lastInstr).count();
-        lastInstr = now;
-        instrAccum += elapsed;
-        timerAccum += elapsed;
+        double elapsed = std::chrono::duration<double>(now - lastFrame).count();
+        lastFrame = now;
+        if (romLoaded && !paused) frameAccum += elapsed;
 
         int dispW = cpu.display().width();
         int dispH = cpu.display().height();
@@ -837,6 +879,11 @@ int main(int argc, char* argv[]) {
         SDL_Event e;
         while (SDL_PollEvent(&e)) {
             if (e.type == SDL_QUIT) running = false;
+            // Resizes, exposes and restores can lose or stretch what was presented
+            if (e.type == SDL_WINDOWEVENT) presentedGeneration = REDRAW;
+            if (e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+                displayRenderer->invalidateLayout();
+            }
             if (e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_RESIZED) {
                 int winW = e.window.data1;
                 int winH = e.window.data2;
@@ -863,8 +910,9 @@ int main(int argc, char* argv[]) {
                     currentRomPath.clear();
                     currentRomData.clear();
                     paused = false;
-                    new (&cpu) Chip8CPU(Chip8CPU::Variant::CHIP8);
-                    cpu.setQuirks({true, true, false});
+                    rewind.clear();
+                    movie.stop();
+                    cpu.reset(Chip8CPU::Variant::CHIP8, Chip8CPU::defaultQuirks(Chip8CPU::Variant::CHIP8));
                     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
                     SDL_RenderClear(renderer);
                     SDL_RenderPresent(renderer);
@@ -876,14 +924,9 @@ int main(int argc, char* argv[]) {
 #endif
                 }
                 if (key == SDLK_r && (mod & KMOD_CTRL) && romLoaded) {
-                    new (&cpu) Chip8CPU(cpu.getVariant());
-                    if (cpu.getVariant() == Chip8CPU::Variant::CHIP8) {
-                        cpu.setQuirks({true, true, false});
-                    } else if (cpu.getVariant() == Chip8CPU::Variant::SCHIP) {
-                        cpu.setQuirks({false, false, true});
-                    } else {
-                        cpu.setQuirks({true, true, false});
-                    }
+                    rewind.clear();
+                    movie.stop();
+                    cpu.reset(cpu.getVariant(), Chip8CPU::defaultQuirks(cpu.getVariant()));
                     cpu.memory().loadROM(currentRomData);
                     resizeWindow(window, cpu.display());
                     lastMode = cpu.display().getMode();
@@ -896,14 +939,9 @@ int main(int argc, char* argv[]) {
                         case Chip8CPU::Variant::SCHIP: nextVariant = Chip8CPU::Variant::XOCHIP; break;
                         case Chip8CPU::Variant::XOCHIP: nextVariant = Chip8CPU::Variant::CHIP8; break;
                     }
-                    new (&cpu) Chip8CPU(nextVariant);
-                    if (nextVariant == Chip8CPU::Variant::CHIP8) {
-                        cpu.setQuirks({true, true, false});
-                    } else if (nextVariant == Chip8CPU::Variant::SCHIP) {
-                        cpu.setQuirks({false, false, true});
-                    } else {
-                        cpu.setQuirks({true, true, false});
-                    }
+                    rewind.clear();
+                    movie.stop();
+                    cpu.reset(nextVariant, Chip8CPU::defaultQuirks(nextVariant));
                     if (romLoaded) {
                         cpu.memory().loadROM(currentRomData);
                     }
@@ -926,7 +964,7 @@ int main(int argc, char* argv[]) {
                 }
                 if (key == SDLK_s && (mod & KMOD_CTRL)) {
                     if (g_cpu) {
-                        bool ok = g_cpu->saveState(getStateSlotPath());
+                        bool ok = g_cpu->saveState(getStateSlotPath(getStateSlotName(stateSlot)));
 #ifdef _WIN32
                         HWND hwnd = nullptr;
                         SDL_SysWMinfo info;
@@ -942,7 +980,9 @@ int main(int argc, char* argv[]) {
                 }
                 if (key == SDLK_l && (mod & KMOD_CTRL)) {
                     if (g_cpu) {
-                        bool ok = g_cpu->loadState(getStateSlotPath());
+                        bool ok = g_cpu->loadState(getStateSlotPath(getStateSlotName(stateSlot)));
+                        // The loaded machine is not the one the movie records or replays
+                        if (ok) movie.stop();
 #ifdef _WIN32
                         HWND hwnd = nullptr;
                         SDL_SysWMinfo info;
@@ -956,6 +996,42 @@ int main(int argc, char* argv[]) {
 #endif
                     }
                 }
+                if (key == SDLK_BACKSPACE && !rewinding && !movie.isRecording() && !movie.isPlaying()) {
+                    rewinding = true;
+                    cpu.sound().stop();
+                }
+                if (key == SDLK_F4) {
+                    runAheadFrames = (runAheadFrames + 1) % (MAX_RUN_AHEAD_FRAMES + 1);
+                    runAheadCost = 0.0;
+                    runAheadSamples = 0;
+                    runAheadStatus = runAheadFrames > 0 ? "run-ahead " + std::to_string(runAheadFrames) : "";
+                    updateTitle();
+                }
+                if (key == SDLK_F6 || key == SDLK_F7) {
+                    stateSlot = (stateSlot + (key == SDLK_F7 ? 0 : 7)) % 9 + 1;
+                    slotStatus = "slot " + std::to_string(stateSlot);
+                    updateTitle();
+#ifdef _WIN32
+                    updateMenuBar();
+#endif
+                }
+                if (key == SDLK_F5 && romLoaded) {
+                    if (movie.isRecording()) {
+                        movie.stopRecording(cpu);
+                        if (!movie.save(getMoviePath())) std::cerr << "Failed to save movie" << std::endl;
+                    } else {
+                        movie.stop();
+                        movie.startRecording(cpu);
+                    }
+                }
+                if (key == SDLK_F8 && romLoaded) {
+                    movie.stop();
+                    if (movie.load(getMoviePath()) && movie.startPlayback(cpu)) {
+                        rewind.clear();
+                    } else {
+                        std::cerr << "Failed to play movie" << std::endl;
+                    }
+                }
                 if (key == SDLK_F3) {
 #ifdef _WIN32
                     if (window && renderer) {
@@ -976,11 +1052,13 @@ int main(int argc, char* argv[]) {
 #endif
                 }
             }
+            if (e.type == SDL_KEYUP && e.key.keysym.sym == SDLK_BACKSPACE) rewinding = false;
             if (e.type == SDL_KEYDOWN || e.type == SDL_KEYUP) {
                 bool pressed = (e.type == SDL_KEYDOWN);
                 for (int i = 0; i < 16; ++i) {
-                    if (e.key.keysym.sym == keymap[i]) {
-                        cpu.input().setKey(i, pressed);
+                    // Keys are ignored while a movie replays its own input
+                    if (e.key.keysym.sym == keymap[i] && !movie.isPlaying()) {
+                        movie.setKey(cpu, i, pressed);
                     }
                 }
             }
@@ -1034,25 +1112,78 @@ int main(int argc, char* argv[]) {
             lastPaused = paused;
         }
 
+        std::string currentMovieStatus = movie.isRecording() ? "recording" : (movie.isPlaying() ? "replaying" : "");
+        if (currentMovieStatus != movieStatus) {
+            movieStatus = currentMovieStatus;
+            updateTitle();
+        }
+
         if (romLoaded && !paused) {
-            while (instrAccum >= instrDelay) {
-                cpu.step();
-                instrAccum -= instrDelay;
-            }
-            while (timerAccum >= timerDelay) {
-                cpu.timers().tick();
-                timerAccum -= timerDelay;
+            bool ranFrame = false;
+            while (frameAccum >= frameDelay) {
+                if (rewinding) {
+                    rewind.stepBack(cpu);
+                    frameAccum -= frameDelay;
+                    continue;
+                }
+                Chip8CPU::RunResult result;
+                uint64_t frame = cpu.getFrameCount();
+                do {
+                    result = movie.runFrame(cpu);
+                } while (cpu.getFrameCount() == frame && result != Chip8CPU::RunResult::Fault);
+                frameAccum -= frameDelay;
+                ranFrame = true;
+                rewind.capture(cpu);
+                if (movie.isPlaying() && movie.isFinished(cpu)) movie.stop();
+                if (result == Chip8CPU::RunResult::Fault) {
+                    std::cerr << "Guest fault at PC " << std::hex << cpu.registers().PC() << std::dec << std::endl;
+                    paused = true;
+                    frameAccum = 0.0;
+                    break;
+                }
             }
             cpu.sound().update();
+            if (runAheadFrames > 0 && ranFrame && !paused) {
+                auto start = std::chrono::high_resolution_clock::now();
+                runAheadState.resize(cpu.snapshotSize());
+                cpu.snapshot(runAheadState.data(), runAheadState.size());
+                bool buzzer = cpu.sound().isOn();
+                for (int i = 0; i < runAheadFrames && cpu.getFault() == Chip8CPU::Fault::None; ++i) {
+                    uint64_t frame = cpu.getFrameCount();
+                    while (cpu.getFrameCount() == frame && cpu.runFrame() != Chip8CPU::RunResult::Fault) {}
+                }
+                runAheadDisplay = cpu.display();
+                cpu.restore(runAheadState);
+                if (buzzer) cpu.sound().start(); else cpu.sound().stop();
+                runAheadFrame = cpu.getFrameCount();
+                runAheadCost += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+                // Report the extra CPU time once per second of play
+                if (++runAheadSamples == TIMER_HZ) {
+                    char status[64];
+                    snprintf(status, sizeof(status), "run-ahead %d: %.2f ms/frame", runAheadFrames,
+                             runAheadCost * 1000.0 / runAheadSamples);
+                    runAheadStatus = status;
+                    updateTitle();
+                    runAheadCost = 0.0;
+                    runAheadSamples = 0;
+                }
+            }
             if (cpu.display().getMode() != lastMode) {
                 resizeWindow(window, cpu.display());
                 lastMode = cpu.display().getMode();
             }
-            renderDisplay(window, renderer, cpu.display());
-        } else if (!romLoaded) {
+            bool showRunAhead = runAheadFrames > 0 && runAheadFrame == cpu.getFrameCount() &&
+                                runAheadDisplay.getMode() == cpu.display().getMode();
+            const Chip8Display& shown = showRunAhead ? runAheadDisplay : cpu.display();
+            if (shown.generation() != presentedGeneration) {
+                displayRenderer->present(window, shown);
+                presentedGeneration = shown.generation();
+            }
+        } else if (!romLoaded && presentedGeneration != BLANK_SCREEN) {
             SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
             SDL_RenderClear(renderer);
             SDL_RenderPresent(renderer);
+            presentedGeneration = BLANK_SCREEN;
         }
         std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
@@ -1063,11 +1194,13 @@ int main(int argc, char* argv[]) {
     g_config.audioVolume = audioVolume;
     for (int i = 0; i < 16; ++i) g_config.inputKeymap[i] = keymap[i];
     g_config.windowScale = windowScale;
+    g_config.runAheadFrames = runAheadFrames;
     if (cpu.getVariant() == Chip8CPU::Variant::CHIP8) g_config.mode = 0;
     else if (cpu.getVariant() == Chip8CPU::Variant::SCHIP) g_config.mode = 1;
     else g_config.mode = 2;
     g_config.save(getConfigPath());
 
+    displayRenderer.reset();
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
@@ -0,0 +1,53 @@
+// CHIP8CHAPA - SDL2 audio sink implementation
+// Opens one SDL2 audio device and feeds it from the attached Chip8Sound
+
+#include "sdl_audio_sink.h"
+#include <cstring>
+
+SDLAudioSink::SDLAudioSink() : audioDevice(0), source(nullptr) {
+    SDL_AudioSpec want{};
+    want.freq = Chip8Sound::SAMPLE_RATE;
+    want.format = AUDIO_U8;
+    want.channels = 1;
+    want.samples = 512;
+    want.callback = audioCallback;
+    want.userdata = this;
+    audioDevice = SDL_OpenAudioDevice(nullptr, 0, &want, nullptr, 0);
+    if (audioDevice != 0) {
+        SDL_PauseAudioDevice(audioDevice, 0);
+    }
+}
+
+SDLAudioSink::~SDLAudioSink() {
+    if (audioDevice != 0) {
+        SDL_CloseAudioDevice(audioDevice);
+    }
+}
+
+void SDLAudioSink::attach(Chip8Sound* sound) {
+    if (audioDevice != 0) SDL_LockAudioDevice(audioDevice);
+    source = sound;
+    if (audioDevice != 0) SDL_UnlockAudioDevice(audioDevice);
+}
+
+void SDLAudioSink::detach(Chip8Sound* sound) {
+    if (audioDevice != 0) SDL_LockAudioDevice(audioDevice);
+    if (source == sound) source = nullptr;
+    if (audioDevice != 0) SDL_UnlockAudioDevice(audioDevice);
+}
+
+void SDLAudioSink::flush() {
+    if (audioDevice != 0) {
+        SDL_PauseAudioDevice(audioDevice, 1);
+        SDL_PauseAudioDevice(audioDevice, 0);
+    }
+}
+
+void SDLAudioSink::audioCallback(void* userdata, Uint8* stream, int len) {
+    SDLAudioSink* self = static_cast<SDLAudioSink*>(userdata);
+    if (self->source) {
+        self->source->render(stream, len);
+    } else {
+        memset(stream, 128, len);
+    }
+}
@@ -0,0 +1,28 @@
+// CHIP8CHAPA - SDL2 audio sink header
+// Declares the audio sink that plays a Chip8Sound through an SDL2 audio device
+
+#ifndef SDL_AUDIO_SINK_H
+#define SDL_AUDIO_SINK_H
+
+#include "chip8_sound.h"
+#include <SDL.h>
+
+class SDLAudioSink : public Chip8AudioSink {
+public:
+    // Opens the default output device (stays silent while nothing is attached)
+    SDLAudioSink();
+    ~SDLAudioSink() override;
+    SDLAudioSink(const SDLAudioSink&) = delete;
+    SDLAudioSink& operator=(const SDLAudioSink&) = delete;
+
+    void attach(Chip8Sound* sound) override;
+    void detach(Chip8Sound* sound) override;
+    void flush() override;
+
+private:
+    SDL_AudioDeviceID audioDevice;
+    Chip8Sound* source; // Guarded by the SDL device lock
+    static void audioCallback(void* userdata, Uint8* stream, int len);
+};
+
+#endif
@@ -0,0 +1,95 @@
+// CHIP8CHAPA - SDL2 display renderer implementation
+// Converts changed display rows through the palette and draws the texture as one quad
+
+#include "sdl_display_renderer.h"
+
+SDLDisplayRenderer::SDLDisplayRenderer(SDL_Renderer* renderer)
+    : renderer(renderer), texture(nullptr), palette{}, uploadedGeneration(UINT64_MAX), uploadedWidth(0),
+      uploadedColorMode(Chip8Display::ColorMode::Mono), layoutValid(false), layoutWidth(0), layoutHeight(0),
+      destRect{0, 0, 0, 0} {
+    texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                                Chip8Display::HIRES_WIDTH, Chip8Display::HIRES_HEIGHT);
+    if (texture) SDL_SetTextureScaleMode(texture, SDL_ScaleModeNearest);
+    setPalette({0x000000, 0x555555, 0xAAAAAA, 0xFFFFFF});
+}
+
+SDLDisplayRenderer::~SDLDisplayRenderer() {
+    if (texture) SDL_DestroyTexture(texture);
+}
+
+void SDLDisplayRenderer::setPalette(const std::array<uint32_t, 4>& colors) {
+    for (int i = 0; i < 4; ++i) palette[i] = 0xFF000000u | (colors[i] & 0xFFFFFF);
+    uploadedGeneration = UINT64_MAX; // Every row is converted again
+}
+
+void SDLDisplayRenderer::invalidateLayout() {
+    layoutValid = false;
+}
+
+void SDLDisplayRenderer::present(SDL_Window* window, const Chip8Display& display) {
+    int w = display.width();
+    int h = display.height();
+    if (!layoutValid || w != layoutWidth || h != layoutHeight) {
+        int winW, winH;
+        SDL_GetWindowSize(window, &winW, &winH);
+        float scaleX = static_cast<float>(winW) / w;
+        float scaleY = static_cast<float>(winH) / h;
+        float scale = (scaleX < scaleY) ? scaleX : scaleY;
+        if (scale < 1.0f) scale = 1.0f;
+        destRect = { 0, 0, static_cast<int>(w * scale), static_cast<int>(h * scale) };
+        layoutWidth = w;
+        layoutHeight = h;
+        layoutValid = true;
+    }
+
+    // A texture from another size, colour mode or an unrelated display is replaced whole
+    uint64_t rows = ~uint64_t(0);
+    if (uploadedGeneration != UINT64_MAX && w == uploadedWidth && display.getColorMode() == uploadedColorMode &&
+        display.generation() >= uploadedGeneration) {
+        rows = display.dirtyRowsSince(uploadedGeneration);
+    }
+    if (texture && rows) uploadRows(display, rows);
+    uploadedGeneration = display.generation();
+    uploadedWidth = w;
+    uploadedColorMode = display.getColorMode();
+
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderClear(renderer);
+    if (texture) {
+        SDL_Rect source = { 0, 0, w, h };
+        SDL_RenderCopy(renderer, texture, &source, &destRect);
+    }
+    SDL_RenderPresent(renderer);
+}
+
+void SDLDisplayRenderer::uploadRows(const Chip8Display& display, uint64_t rows) {
+    int w = display.width();
+    int h = display.height();
+    // Mono shows any set pixel in the "both planes" colour
+    const uint32_t mono[4] = { palette[0], palette[3], palette[3], palette[3] };
+    const uint32_t* colors = (display.getColorMode() == Chip8Display::ColorMode::XOCHIP_2BPP) ? palette.data() : mono;
+    const Chip8Display::Plane& plane0 = display.plane(0);
+    const Chip8Display::Plane& plane1 = display.plane(1);
+    constexpr int PITCH = Chip8Display::HIRES_WIDTH;
+
+    int y = 0;
+    while (y < h) {
+        if (!(rows >> y & 1)) {
+            ++y;
+            continue;
+        }
+        // Convert a run of changed rows, then upload it in one call
+        int first = y;
+        for (; y < h && (rows >> y & 1); ++y) {
+            uint32_t* out = pixels.data() + y * PITCH;
+            for (int x = 0; x < w; ++x) {
+                int shift = 63 - (x & 63);
+                int value = static_cast<int>(plane0[y][x >> 6] >> shift & 1) |
+                            static_cast<int>(plane1[y][x >> 6] >> shift & 1) << 1;
+                out[x] = colors[value];
+            }
+        }
+        SDL_Rect area = { 0, first, w, y - first };
+        SDL_UpdateTexture(texture, &area, pixels.data() + first * PITCH, PITCH * sizeof(uint32_t));
+    }
+}
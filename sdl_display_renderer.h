@@ -0,0 +1,50 @@
+// CHIP8CHAPA - SDL2 display renderer header
+// Declares the renderer that presents a Chip8Display through one streaming SDL2 texture
+
+#ifndef SDL_DISPLAY_RENDERER_H
+#define SDL_DISPLAY_RENDERER_H
+
+#include "chip8_display.h"
+#include <SDL.h>
+#include <array>
+#include <cstdint>
+
+// Keeps the display in a 128x64 streaming texture and draws it as one scaled quad, so a
+// frame costs the same however many pixels are lit. Only the rows changed since the last
+// upload are converted and uploaded (Chip8Display::dirtyRowsSince).
+class SDLDisplayRenderer {
+public:
+    // The texture belongs to renderer; destroy this object before the renderer
+    explicit SDLDisplayRenderer(SDL_Renderer* renderer);
+    ~SDLDisplayRenderer();
+    SDLDisplayRenderer(const SDLDisplayRenderer&) = delete;
+    SDLDisplayRenderer& operator=(const SDLDisplayRenderer&) = delete;
+
+    // Colours as 0xRRGGBB indexed by the pixel's plane bits (XO-CHIP 2bpp);
+    // mono displays use entry 0 for off and entry 3 for on
+    void setPalette(const std::array<uint32_t, 4>& colors);
+    // The window size changed: the quad is placed again on the next present
+    void invalidateLayout();
+    // Uploads the changed rows of display and presents it scaled to the window
+    void present(SDL_Window* window, const Chip8Display& display);
+
+private:
+    void uploadRows(const Chip8Display& display, uint64_t rows);
+
+    SDL_Renderer* renderer;
+    SDL_Texture* texture;
+    std::array<uint32_t, 4> palette; // ARGB8888
+    std::array<uint32_t, Chip8Display::HIRES_WIDTH * Chip8Display::HIRES_HEIGHT> pixels{}; // Texture contents
+    // What the texture holds: rows of this generation, size and colour mode (all rows are
+    // uploaded again when anything but the generation differs)
+    uint64_t uploadedGeneration;
+    int uploadedWidth;
+    Chip8Display::ColorMode uploadedColorMode;
+    // Cached placement of the quad, valid for layoutWidth x layoutHeight displays
+    bool layoutValid;
+    int layoutWidth;
+    int layoutHeight;
+    SDL_Rect destRect;
+};
+
+#endif